@@ -126,8 +126,9 @@ public:
     /// @param x X-coordinate to clear
     /// @param y Y-coordinate to clear
     void damage(int x, int y) {
-        if (x >= 0 && x < width && y >= 0 && y < height) {
+        if (x >= 0 && x < width && y >= 0 && y < height && data[y][x] != 0) {
             data[y][x] = 0;
+            ++version;  ///< The recorded frames have to see the change
         }
     }
 
@@ -152,5 +153,6 @@ public:
                 data[y][x] = original_data[y][x];
             }
         }
+        ++version;
     }
 };
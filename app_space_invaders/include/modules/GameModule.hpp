@@ -21,6 +21,7 @@
 #include "app_space_invaders/assets/sprites/TurretShotSprite.hpp"
 
 #include <ctime>
+#include <random>
 #include <utility>
 #include <vector>
 
@@ -65,6 +66,10 @@ public:
     /// @details Clears entities, shots, scores, and resets player lives and positions.
     void reset_game();
 
+    /// @brief Seeds the generator picking the shooting aliens.
+    /// @details Games with the same seed and input play the same, used by the golden frame tests.
+    void seed(uint32_t value);
+
 private:
     /// @name Core update routines
     /// @{ 
@@ -137,6 +142,8 @@ private:
     int alien_speed = 1;             ///< Speed multiplier for alien movement
 
     int turret_lives = 4;            ///< Remaining player lives
+
+    std::mt19937 random_engine{std::random_device{}()}; ///< Picks the shooting aliens
     /// @}
 
     /// @brief Delay timing for game loop
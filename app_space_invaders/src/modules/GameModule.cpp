@@ -226,9 +226,8 @@ void GameModule::aliens_shoot() {
     if (shooters.empty()) return;
 
     // pick random shooter
-    std::mt19937 gen{std::random_device{}()};
     std::uniform_int_distribution<> dist(0, shooters.size()-1);
-    auto &sh = entities[shooters[dist(gen)]];
+    auto &sh = entities[shooters[dist(random_engine)]];
 
     // spawn alien shot
     Entity shot{ sh.pos_x + sh.sprite->width/2 - alien_shot.width/2,
@@ -290,6 +289,10 @@ bool GameModule::handle_entity_collisions(Entity &shot) {
     return false;
 }
 
+void GameModule::seed(uint32_t value) {
+    random_engine.seed(value);
+}
+
 void GameModule::reset_game() {
     int turret_y = SCREEN_HEIGHT - base.height - 5;
     turret_x = (SCREEN_WIDTH - base.width) / 2;
@@ -52,8 +52,14 @@ constexpr Tone Tone::NullTone = Tone(500000, 1000);
 class AudioDriver {
     public:
         /// @brief Constructor for the AudioDriver class.
+        /// @throw std::runtime_error if the physical address mapping fails.
         AudioDriver();
 
+        /// @brief Constructor for already mapped PWM registers.
+        /// @param pwm_reg The registers, e.g. plain memory when running without the board.
+        /// @throw std::runtime_error if pwm_reg is nullptr.
+        explicit AudioDriver(void *pwm_reg);
+
         /// @brief Destructor for the AudioDriver class.
         /// @note This destructor first sends a stop request and then wakes it up if needed.
         /// @note It waits for the join before returning.
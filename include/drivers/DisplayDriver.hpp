@@ -9,18 +9,33 @@
 
 #pragma once
 
+#include "include/drivers/PanelBackend.hpp"
+
 #include "include/utils/Color.hpp"
+#include "include/utils/DamageList.hpp"
+#include "include/utils/DisplayList.hpp"
+#include "include/utils/FrameCapture.hpp"
+#include "include/utils/Point.hpp"
+#include "include/utils/Rect.hpp"
 
+#include "include/sprites/Image.hpp"
 #include "include/sprites/Sprite.hpp"
-
-#include "third_party/mzapo/mzapo_parlcd.h"
-#include "third_party/mzapo/mzapo_phys.h"
-#include "third_party/mzapo/mzapo_regs.h"
+#include "include/sprites/Surface.hpp"
 
 #include "assets/fonts/font_types.h"
 
+#include <atomic>
+#include <bitset>
+#include <chrono>
+#include <condition_variable>
 #include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <mutex>
+#include <span>
+#include <stop_token>
 #include <string_view>
+#include <thread>
 #include <utility>
 
 /// @brief FontType enum for different font types.
@@ -39,6 +54,46 @@ namespace DisplayConstants {
         constexpr int ScreenHeight = 320;
     } // namespace Hardware
 
+    /// @brief HX8357 command codes used by the driver.
+    namespace Panel {
+        constexpr uint16_t ColumnAddressSet = 0x2A;
+        constexpr uint16_t PageAddressSet = 0x2B;
+        constexpr uint16_t MemoryWrite = 0x2C;
+        constexpr uint16_t VerticalScrollDefinition = 0x33;
+        constexpr uint16_t MemoryAccessControl = 0x36;
+        constexpr uint16_t VerticalScrollStart = 0x37;
+
+        /// @brief Native rows of the panel, the hardware scroll moves along them. They run down
+        /// the screen in portrait and across it in landscape.
+        constexpr int Lines = Hardware::ScreenWidth;
+
+        /// @brief MADCTL values, landscape is the value set by parlcd_hx8357_init().
+        /// @note Portrait drops the row/column exchange and the column mirror of the landscape
+        /// value, which turns the image by 90 degrees.
+        constexpr uint16_t MadctlLandscape = 0xE8;
+        constexpr uint16_t MadctlPortrait = 0x88;
+    } // namespace Panel
+
+    namespace Storage {
+        constexpr int Alignment = 64; // Cache line of the Cortex-A9, every pixel buffer starts here
+    } // namespace Storage
+
+    namespace Flush {
+        constexpr int TileSize = 16; // Tile edge of the TileDiff and TileHash flush modes
+    } // namespace Flush
+
+    namespace Band {
+        constexpr int Height = 16; // Rows per band in render_banded(), 15 KB per band buffer
+    } // namespace Band
+
+    namespace Palette {
+        constexpr int Size = 256; // Entries of the indexed color mode lookup table
+    } // namespace Palette
+
+    namespace Polygon {
+        constexpr int MaxPoints = 64; // Vertices of one fill_polygon(), its edges live on the stack
+    } // namespace Polygon
+
     namespace Text {
         constexpr int VerticalSpacing = 2;   // Vertical spacing between lines of text
         constexpr int HorizontalSpacing = 1; // Horizontal spacing between letters
@@ -53,15 +108,65 @@ enum class DisplayOrientation : uint8_t {
     Landscape,
 };
 
+/// @brief BusMode enum for the way pixels are written to the parallel LCD bus.
+/// @details The PARLCD data register accepts both 16-bit and 32-bit stores, a 32-bit store is
+/// split into two pixel transfers. Paired assumes the lower half is sent first, which has not been
+/// checked on the board yet, with the opposite order every pair of pixels would be swapped.
+enum class BusMode : uint8_t {
+    Single, ///< One 16-bit store per pixel.
+    Paired, ///< Two pixels packed into every 32-bit store, halves the number of bus transactions.
+};
+
+/// @brief FlushMode enum for deciding which pixels are sent to the display.
+enum class FlushMode : uint8_t {
+    Damage,   ///< Send every damaged rectangle.
+    TileDiff, ///< Compare damaged tiles against the last sent frame and send only changed tiles.
+    TileHash, ///< Hash damaged tiles in flush() and drop the ones whose hash did not change.
+};
+
+/// @brief DrawMode enum for deciding when draw calls touch the frame buffer.
+enum class DrawMode : uint8_t {
+    Immediate, ///< Rasterize every draw call right away.
+    Recorded,  ///< Record draw calls, flush() rasterizes only what changed since the last frame.
+};
+
+/// @brief Resolution enum for the size of the frame buffer compared to the panel.
+enum class Resolution : uint8_t {
+    Full, ///< One frame buffer pixel per panel pixel.
+    Half, ///< Half the width and height, flush() sends every pixel as a 2x2 block.
+};
+
+/// @brief BufferStorage enum for where the buffers of the DisplayDriver live.
+/// @details The pixel buffers and the tables of the driver take over a megabyte, so they are
+/// never part of the driver object.
+enum class BufferStorage : uint8_t {
+    Static, ///< A static array, only one driver at a time can use it.
+    Heap,   ///< Allocated and zeroed by the constructor.
+    Locked, ///< Mapped with MAP_POPULATE and locked with mlock, drawing never hits a page fault.
+};
+
+/// @brief Statistics of the last flush, useful for measuring the cost of different flush modes.
+struct FlushStats {
+    int pixels = 0;     ///< Number of pixels sent to the display.
+    int bus_writes = 0; ///< Number of stores to the PARLCD data register, commands excluded.
+    std::chrono::microseconds duration{0}; ///< Time spent sending the frame to the display.
+};
+
 /// @brief DisplayDriver class for controlling the MZAPO display.
+/// @note Drawing goes into a back buffer, flush() copies the damaged parts into a front buffer
+/// which a worker thread sends to the display while the next frame is being drawn.
 class DisplayDriver {
     public:
         /// @brief Constructor for DisplayDriver.
         /// @param orientation The orientation of the display (Portrait or Landscape).
-        /// @throw std::runtime_error if the physical address mapping fails.
-        DisplayDriver(DisplayOrientation);
+        /// @param storage Where to keep the pixel buffers, all of them are in memory before the
+        /// first frame.
+        /// @throw std::runtime_error if the panel backend can not be opened (the physical address
+        /// mapping on the board), the buffer allocation fails or the static buffers are in use.
+        DisplayDriver(DisplayOrientation, BufferStorage storage = BufferStorage::Locked);
 
         /// @brief Destructor for DisplayDriver.
+        /// @note Waits for the last flushed frame to reach the display before stopping the worker.
         ~DisplayDriver();
 
         /// @brief Sets a pixel on the display to a specific color.
@@ -87,8 +192,46 @@ class DisplayDriver {
         /// @param height Height of the rectangle
         /// @param color Color to fill the rectangle with
         /// @note Out of bounds pixels will not be set.
+        /// @note The rectangle is clipped once and filled row by row as contiguous spans.
         void draw_rectangle(int x, int y, int width, int height, Color color);
 
+        /// @brief Draws a one pixel wide line between two points, both end points included.
+        /// @param x0 X coordinate of the start point
+        /// @param y0 Y coordinate of the start point
+        /// @param x1 X coordinate of the end point
+        /// @param y1 Y coordinate of the end point
+        /// @param color Color of the line
+        /// @note Integer Bresenham, the part outside of the screen is skipped without stepping
+        /// through it. Horizontal and vertical lines are a single span.
+        /// @note Consecutive pixels sharing a row (or a column for steep lines) are written as one
+        /// span instead of pixel by pixel.
+        void draw_line(int x0, int y0, int x1, int y1, Color color);
+
+        /// @brief Draws the outline of a circle.
+        /// @param center_x X coordinate of the center
+        /// @param center_y Y coordinate of the center
+        /// @param radius Radius in pixels, the circle is 2 * radius + 1 pixels wide
+        /// @param color Color of the outline
+        /// @note Midpoint circle algorithm, one octant is computed and mirrored as spans.
+        void draw_circle(int center_x, int center_y, int radius, Color color);
+
+        /// @brief Draws a filled circle, covering exactly the pixels inside of draw_circle().
+        /// @param center_x X coordinate of the center
+        /// @param center_y Y coordinate of the center
+        /// @param radius Radius in pixels
+        /// @param color Color to fill the circle with
+        void fill_circle(int center_x, int center_y, int radius, Color color);
+
+        /// @brief Fills a convex or concave polygon.
+        /// @param points The vertices in order, the last one connects back to the first one.
+        /// @param color Color to fill the polygon with
+        /// @note Scanline conversion with the even-odd rule, so self intersecting polygons get
+        /// holes. A pixel is filled when its top left corner is inside, the polygon of the corners
+        /// of a rectangle fills the same pixels as draw_rectangle().
+        /// @note At most DisplayConstants::Polygon::MaxPoints vertices, bigger polygons are not
+        /// drawn.
+        void fill_polygon(std::span<const Point> points, Color color);
+
         /// @brief Draws a specific character on the display at a specific position.
         /// @param x X coordinate of the character top left corner
         /// @param y Y coordinate of the character top left corner
@@ -119,23 +262,224 @@ class DisplayDriver {
         /// @param color The color to draw the sprite with.
         void draw_sprite(int x, int y, const Sprite &sprite, Color color);
 
+        /// @brief Copies a full color image onto the display.
+        /// @param x X top left corner of the image
+        /// @param y Y top left corner of the image
+        /// @param image The RGB565 image to copy.
+        /// @note The image is clipped once and copied row by row with memcpy, it is placed in the
+        /// current orientation like every other draw call.
+        /// @note In the indexed mode every pixel is drawn as the closest palette entry.
+        void draw_image(int x, int y, const Image &image);
+
+        /// @brief Copies a full color image onto the display, leaving out one transparent color.
+        /// @param x X top left corner of the image
+        /// @param y Y top left corner of the image
+        /// @param image The RGB565 image to copy.
+        /// @param color_key Pixels of this color are not drawn.
+        void draw_image(int x, int y, const Image &image, Color color_key);
+
+        /// @brief Copies a surface onto the display.
+        /// @param x X top left corner of the surface
+        /// @param y Y top left corner of the surface
+        /// @param surface The surface to copy, drawn beforehand with draw_to().
+        /// @note Surfaces in the pixel format of the frame buffer are copied row by row, an
+        /// Indexed8 surface is expanded through the palette when the frame buffer is Rgb565. An
+        /// Rgb565 surface is drawn with the closest palette entries in the indexed mode.
+        /// @note In the recorded draw mode the surface is read in flush(), like sprites. Its
+        /// version decides whether it changed, not its pixels.
+        void draw_surface(int x, int y, const Surface &surface);
+
+        /// @brief Copies a surface onto the display, leaving out one transparent color.
+        /// @param x X top left corner of the surface
+        /// @param y Y top left corner of the surface
+        /// @param surface The surface to copy.
+        /// @param color_key Pixels of this color are not drawn, for an Indexed8 surface the
+        /// palette entry the color is drawn with.
+        void draw_surface(int x, int y, const Surface &surface, Color color_key);
+
+        /// @brief Draws into a surface instead of the display.
+        /// @param surface The surface to draw into.
+        /// @param draw Draws with the usual draw_* calls in the coordinates of the surface, it is
+        /// clipped to the surface.
+        /// @details The surface takes the place of the frame buffer while the callback runs,
+        /// nothing is recorded or damaged. fill_screen() clears the surface.
+        /// @note Colors of an Indexed8 surface are looked up in the current palette, images and
+        /// blending snap to the closest entries just like in the indexed color mode.
+        /// @note Calling flush() inside of the callback does nothing.
+        void draw_to(Surface &surface, const std::function<void()> &draw);
+
+        /// @brief Blends a translucent rectangle over what is already drawn.
+        /// @param x X top left corner of the rectangle
+        /// @param y Y top left corner of the rectangle
+        /// @param width Width of the rectangle
+        /// @param height Height of the rectangle
+        /// @param color The color of the rectangle.
+        /// @param alpha Opacity from 0 (invisible) to 255 (same as draw_rectangle()).
+        /// @note Blending works on the packed RGB565 pixels with 32 levels of opacity, there is no
+        /// floating point math involved. In the indexed mode the result is the palette entry
+        /// closest to the blend of the color and the entry underneath.
+        void blend_rectangle(int x, int y, int width, int height, Color color, uint8_t alpha);
+
+        /// @brief Blends a full color image over what is already drawn.
+        /// @param x X top left corner of the image
+        /// @param y Y top left corner of the image
+        /// @param image The RGB565 image to blend.
+        /// @param alpha Opacity of the whole image from 0 to 255.
+        void blend_image(int x, int y, const Image &image, uint8_t alpha);
+
+        /// @brief Fades the whole screen towards a color.
+        /// @param color The color to fade towards, usually black.
+        /// @param alpha How far to fade, 0 keeps the screen and 255 is the same as fill_screen().
+        /// @note Meant for pause dimming and transitions between modules, it is cheap enough to be
+        /// called every frame.
+        void fade_screen(Color color, uint8_t alpha);
+
         /// @brief Fills the entire screen with a specific color.
         /// @param color The color to fill the screen with.
         /// @note Mostly used for black but I added color specification for funsies. Might be useful
         /// in the future.
+        /// @note Clearing with the same color as the previous clear only damages the areas drawn
+        /// since then, the rest of the screen already holds that color.
         void fill_screen(Color color);
 
-        /// @brief Flushes the frame buffer into the display memory
-        /// @note The display orientation in memory is different from the buffer, so I have to pay
-        /// the rotation tax somewhere so I decided that it should be paid in flush();
+        /// @brief Flushes the damaged parts of the frame buffer into the display memory.
+        /// @details Every draw call records the rectangle it touched, the worker thread then
+        /// programs the panel column/page address window for each damaged rectangle and streams
+        /// only those pixels.
+        /// @note The frame buffer is row-major in the current orientation, the panel does the
+        /// rotation itself (see set_orientation()).
+        /// @note Only waits for the previous frame to finish, copies the damaged rectangles into
+        /// the front buffer and returns. Use wait_for_flush() when the frame has to be visible.
         void flush();
 
+        /// @brief Renders a frame band by band, sending each band while the next one is drawn.
+        /// @param draw Draws the whole frame with the usual draw_* calls, it is called once per
+        /// band with drawing clipped to that band.
+        /// @details The screen is split into horizontal bands of DisplayConstants::Band::Height
+        /// rows. Each band is drawn into one of two small band buffers and handed to the worker
+        /// thread, so rasterization overlaps with the bus transfer and the working set fits into
+        /// the caches. The callback does not need to know anything about the band geometry.
+        /// @note The frame is sent to the display as it is drawn, calling flush() inside of the
+        /// callback does nothing.
+        /// @note The frame buffer is bypassed, its contents are undefined afterwards and the next
+        /// flush() sends the whole frame buffer again.
+        void render_banded(const std::function<void()> &draw);
+
+        /// @brief Sets the rows scroll() moves, the rows above and below them stay in place.
+        /// @param top_fixed Number of rows at the top of the screen that do not scroll.
+        /// @param bottom_fixed Number of rows at the bottom of the screen that do not scroll.
+        /// @note The whole screen scrolls by default. Changing the area sends the whole screen
+        /// again on the next flush().
+        void set_scroll_area(int top_fixed, int bottom_fixed);
+
+        /// @brief Scrolls the scroll area and draws only the rows that come into view.
+        /// @param lines How far to move the contents, positive moves them up and negative down.
+        /// @param draw Draws the whole frame after the scroll with the usual draw_* calls
+        /// (including the background), it is clipped to the exposed rows.
+        /// @details In portrait the panel scrolls in hardware (vertical scroll definition and
+        /// scroll start address), the frame buffer rows are rotated to match and the next flush()
+        /// only sends the exposed rows. In landscape the panel scrolls across the screen instead,
+        /// so the rows are moved with scroll_region() and the whole scroll area is sent. The same
+        /// goes for Resolution::Half, where a frame buffer row covers two panel rows.
+        /// @note Anything drawn before is flushed first. The flush after the call sends the new
+        /// scroll position together with the exposed rows.
+        /// @note Inside of the callback of render_banded() the frame is drawn from scratch
+        /// anyway, so only draw is called.
+        void scroll(int lines, const std::function<void()> &draw);
+
+        /// @brief Moves the pixels of a rectangle of the frame buffer up or down.
+        /// @param rect The rectangle to move the pixels in, clipped to the screen.
+        /// @param dy How far to move the pixels, positive moves them down.
+        /// @return The strip of the rectangle the move uncovered, it still holds the old pixels
+        /// and is left to the caller to redraw. Empty if nothing moved.
+        /// @details Rows are moved with memmove, so redrawing after a scroll costs as much as the
+        /// uncovered strip. The whole rectangle is damaged, the panel still shows the old rows.
+        /// @note Recorded draw calls are rasterized first. Does nothing inside of the callback of
+        /// render_banded().
+        Rect scroll_region(const Rect &rect, int dy);
+
+        /// @brief Stores every flushed frame in a capture file, nullptr stops capturing.
+        /// @details The worker thread stores each frame of flush() from the front buffer once it
+        /// is sent, and the frames of render_banded() band by band, so capturing adds no work to
+        /// the drawing thread. The capture has to outlive its use by the driver, replacing it
+        /// waits for the frames in flight.
+        void set_frame_capture(FrameCapture *capture);
+
+        /// @brief Blocks until every flushed frame has been sent to the display.
+        /// @note This method is thread safe.
+        void wait_for_flush();
+
+        /// @brief Sets the way pixels are written to the display bus.
+        /// @param mode Single 16-bit stores or paired 32-bit stores.
+        /// @note Single is the default until the half order of the paired stores is confirmed on
+        /// the board, make bench-flush measures what Paired saves.
+        void set_bus_mode(BusMode mode);
+
+        /// @brief Sets which pixels flush() sends to the display.
+        /// @param mode Damage sends all damaged rectangles, TileDiff additionally skips tiles that
+        /// are identical to the last frame sent.
+        /// @note TileDiff keeps a shadow copy of the panel contents, useful for modules that redraw
+        /// the same frame over and over again.
+        /// @note TileHash keeps a hash per tile instead and filters the damage before anything is
+        /// copied, an unchanged frame costs one pass over the damaged pixels and no bus traffic.
+        void set_flush_mode(FlushMode mode);
+
+        /// @brief Sets when draw calls are rasterized.
+        /// @param mode Immediate draws right away, Recorded records the draw calls of a frame and
+        /// compares them with the previous frame in flush().
+        /// @details In the recorded mode only the areas of the draw calls that differ from the
+        /// previous frame are rasterized and sent, an identical frame costs no drawing and no bus
+        /// traffic at all. Frames with more draw calls than fit into a DisplayList fall back to
+        /// immediate drawing.
+        /// @note Sprites are read again in flush(), they have to stay alive until then. Changes
+        /// of sprites and images are told apart by their version, not their pixels, so whoever
+        /// changes the pixels has to bump it.
+        void set_draw_mode(DrawMode mode);
+
+        /// @brief Sets the pixel format of the frame buffer.
+        /// @param mode Rgb565 or Indexed8.
+        /// @details In the indexed mode every draw call looks its color up in the palette once and
+        /// writes 8-bit indices, flush() expands the damaged parts through the palette into the
+        /// front buffer. A color tied to a palette entry (Color::in_slot()) is drawn with that
+        /// entry, any other color with the matching or closest entry.
+        /// @note Images and blending results are drawn as their closest palette entries, so they
+        /// look best with a palette holding their colors.
+        /// @note The frame buffer contents are not converted when switching into the indexed
+        /// mode, the next frame has to be drawn from scratch.
+        void set_color_mode(ColorMode mode);
+
+        /// @brief Sets the palette of the indexed color mode.
+        /// @param colors Up to DisplayConstants::Palette::Size colors, see theme_palette().
+        /// @details A color tied to its own entry reserves the entry for the colors drawn with
+        /// that slot, the other colors never land on it.
+        /// @note Already drawn pixels keep their index, so in the indexed mode swapping the palette
+        /// recolors the screen without a redraw. Pixels drawn with a slot take the new color of
+        /// their entry, the others keep theirs as long as the new palette holds it in the same
+        /// entry.
+        void set_palette(std::span<const Color> colors);
+
+        /// @brief Gets the statistics of the last frame sent to the display.
+        /// @return Pixel count, bus transaction count and transfer time of the last frame.
+        /// @note This method is thread safe.
+        FlushStats get_flush_stats() const;
+
         /// @brief Sets the orientation of the display.
         /// @param orientation The orientation to set (Portrait or Landscape).
         /// @note This function can be called at any time, it will blackout the screen so you can
         /// redraw it again.
+        /// @note The rotation is done by the panel through its memory access control register,
+        /// so drawing never has to remap coordinates.
         void set_orientation(DisplayOrientation orientation);
 
+        /// @brief Sets the resolution of the frame buffer.
+        /// @param resolution Full, or Half for 240x160 in landscape and 160x240 in portrait.
+        /// @details Everything is drawn at the lower resolution, a quarter of the pixels to
+        /// rasterize, copy and diff. The worker doubles every pixel and every row while streaming
+        /// the damaged windows to the panel, the bus traffic stays the same.
+        /// @note get_width() and get_height() return the new size. Like set_orientation() it
+        /// blacks out the screen, the frame has to be drawn again.
+        void set_resolution(Resolution resolution);
+
         /// @brief Gets the width of the display in the current orientation.
         /// @return Width of the display in pixels.
         /// @note This width is determined by the orientation not the hardware.
@@ -146,14 +490,214 @@ class DisplayDriver {
         /// @note This height is determined by the orientation not the hardware.
         int get_height() const;
 
+        /// @brief Gives access to the panel backend, e.g. the MemoryBackend of a host build.
+        /// @note The worker writes to the backend, call wait_for_flush() before reading it.
+        const PanelBackend &get_backend() const { return backend; }
+        PanelBackend &get_backend() { return backend; }
+
     private:
-        void *lcd;
-        uint16_t
-            fb[DisplayConstants::Hardware::ScreenWidth * DisplayConstants::Hardware::ScreenHeight];
+        /// @brief What a part of the frame buffer held at its last fill_screen(), used to limit
+        /// the damage of the next clear with the same color.
+        struct ClearRecord {
+            DamageList drawn;   ///< Everything drawn since the clear.
+            Color color = Color::Black; ///< Color of the clear, its slot picks the index.
+            bool valid = false; ///< Whether the rest of the part still holds value.
+
+            void forget() {
+                drawn.clear();
+                valid = false;
+            }
+        };
+
+        /// @brief Buffer the drawing primitives write into.
+        struct RenderTarget {
+            uint16_t *pixels = nullptr;    ///< Start of the buffer, holds screen row origin_y.
+            int stride = 0;                ///< Distance between two rows in pixels.
+            int origin_y = 0;              ///< Screen row stored in the first buffer row.
+            Rect clip;                     ///< Part of the screen the buffer covers.
+            DamageList *damage = nullptr;  ///< Receives the drawn rectangles, nullptr to skip.
+            uint8_t *indices = nullptr;    ///< Palette index buffer used instead of pixels.
+            ClearRecord *clears = nullptr; ///< Clear tracking of the clip, nullptr to skip.
+
+            uint16_t *row(int y) const { return pixels + (y - origin_y) * stride; }
+
+            uint8_t *index_row(int y) const { return indices + (y - origin_y) * stride; }
+        };
+
+        /// @brief Rows moved by the hardware scroll, in rows of the current orientation.
+        struct ScrollArea {
+            int top = 0;                                 ///< First scrolling row.
+            int bottom = DisplayConstants::Panel::Lines; ///< One past the last scrolling row.
+            /// @brief Screen row top shows panel memory row top + offset.
+            int offset = 0;
+
+            bool operator==(const ScrollArea &other) const = default;
+        };
+
+        /// @brief A unit of work for the flush worker.
+        struct FlushJob {
+            DamageList rects;                 ///< Rectangles to send, in screen coordinates.
+            const uint16_t *buffer = nullptr; ///< Buffer holding the pixels of the rectangles.
+            int origin_y = 0;                 ///< Screen row stored in the first buffer row.
+            BusMode bus_mode = BusMode::Single;
+            FlushMode flush_mode = FlushMode::Damage;
+            bool reset_shadow = false; ///< The shadow no longer matches the panel.
+            ScrollArea scroll;         ///< Hardware scroll the panel has to use for the job.
+            /// @brief Receives the buffer rows capture_top to capture_bottom once they are sent,
+            /// nullptr to skip. Row 0 begins a capture frame and the last screen row ends it.
+            FrameCapture *capture = nullptr;
+            int capture_top = 0;
+            int capture_bottom = 0;
+            bool changed = true; ///< Whether the job changes the screen, frames may skip it.
+        };
+
+        /// @brief Every pixel buffer of the driver, rows of both orientations start a cache line.
+        /// @details The display lists, tile hashes and the palette are kept here as well, they
+        /// would make the driver object too big for a stack.
+        struct PixelBuffers {
+            static constexpr int Pixels =
+                DisplayConstants::Hardware::ScreenWidth * DisplayConstants::Hardware::ScreenHeight;
+            static constexpr int BandPixels =
+                DisplayConstants::Hardware::ScreenWidth * DisplayConstants::Band::Height;
+
+            alignas(DisplayConstants::Storage::Alignment) uint16_t back[Pixels];
+            alignas(DisplayConstants::Storage::Alignment) uint16_t front[Pixels];
+            alignas(DisplayConstants::Storage::Alignment) uint16_t shadow[Pixels];
+            alignas(DisplayConstants::Storage::Alignment) uint8_t indices[Pixels];
+            alignas(DisplayConstants::Storage::Alignment) uint16_t bands[2][BandPixels];
+            DisplayList lists[2];
+            uint16_t palette[DisplayConstants::Palette::Size];
+            uint32_t tile_hashes[(DisplayConstants::Hardware::ScreenWidth /
+                                  DisplayConstants::Flush::TileSize) *
+                                 (DisplayConstants::Hardware::ScreenHeight /
+                                  DisplayConstants::Flush::TileSize)];
+        };
+
+        /// @brief Owns the pixel buffers for the lifetime of the driver.
+        class BufferOwner {
+            public:
+                /// @throw std::runtime_error if the buffers can not be allocated.
+                explicit BufferOwner(BufferStorage storage);
+                ~BufferOwner();
+                BufferOwner(const BufferOwner &) = delete;
+                BufferOwner &operator=(const BufferOwner &) = delete;
+
+                PixelBuffers *get() const { return buffers; }
+
+            private:
+                BufferStorage storage;
+                PixelBuffers *buffers = nullptr;
+        };
+
+        /// @brief Buffers of BufferStorage::Static and whether a driver is using them.
+        static PixelBuffers static_buffers;
+        static std::atomic<bool> static_buffers_taken;
+
+        /// @brief Where the panel traffic goes, only used by the worker while a transfer runs.
+        PanelBackend backend;
+        BusMode bus_mode = BusMode::Single;
+        FlushMode flush_mode = FlushMode::Damage;
+
+        /// @brief Declared before the worker thread, the buffers are released after it joins.
+        BufferOwner buffers;
+
+        uint16_t *fb = buffers.get()->back;
+
+        /// @brief Copy of the flushed frame, only touched by the worker while a transfer runs.
+        uint16_t *front = buffers.get()->front;
+
+        /// @brief What the panel is showing, used by FlushMode::TileDiff. Worker thread only.
+        uint16_t *shadow = buffers.get()->shadow;
+        bool shadow_valid = false;
+
+        /// @brief Frame buffer of the indexed color mode, used instead of fb.
+        uint8_t *index_fb = buffers.get()->indices;
+        ColorMode color_mode = ColorMode::Rgb565;
+        uint16_t *palette = buffers.get()->palette;
+        int palette_size = 1; // A single black entry until set_palette()
+
+        /// @brief Entries given as a color tied to that entry, only colors with the slot use them.
+        std::bitset<DisplayConstants::Palette::Size> palette_slots;
+        bool palette_has_plain = true; // Whether any entry is left for colors without a slot
+
+        /// @brief Hash of every tile of the frame buffer as it was last flushed, for TileHash.
+        uint32_t *tile_hashes = buffers.get()->tile_hashes;
+        bool tile_hashes_valid = false;
+
+        /// @brief Two band buffers for render_banded(), one is drawn while the other is sent.
+        uint16_t *band_buffers[2] = {buffers.get()->bands[0], buffers.get()->bands[1]};
+
+        /// @brief Draw calls of the current and the previous frame in DrawMode::Recorded.
+        DisplayList *display_lists = buffers.get()->lists;
+        int current_list = 0;
+        bool previous_list_valid = false;
+        DrawMode draw_mode = DrawMode::Immediate;
+
+        /// @brief Set while draw calls are recorded instead of rasterized.
+        bool recording_frame = false;
+
+        /// @brief Set when the display list ran full and the frame is drawn immediately.
+        bool record_overflow = false;
+
+        /// @brief Set while render_banded() or draw_to() runs the drawing callback.
+        bool in_render_callback = false;
+
+        /// @brief Where the drawing primitives write to.
+        RenderTarget target;
+
+        /// @brief Dimensions in the current orientation, screen_width is also the buffer stride.
         int screen_width = DisplayConstants::Hardware::ScreenWidth;
         int screen_height = DisplayConstants::Hardware::ScreenHeight;
         DisplayOrientation orientation;
 
+        /// @brief Panel pixels per frame buffer pixel along each axis, 2 in Resolution::Half.
+        Resolution resolution = Resolution::Full;
+        int scale = 1;
+
+        /// @brief Set when the buffer layout changed and the shadow no longer matches the panel.
+        bool shadow_reset_requested = false;
+
+        /// @brief Scroll area of the current orientation and the scroll the panel will get.
+        ScrollArea scroll_area;
+        bool scroll_pending = false;
+
+        /// @brief Scroll the panel is using, owned by the worker thread.
+        ScrollArea panel_scroll;
+
+        /// @brief Receives the flushed frames, nullptr when nothing is captured.
+        FrameCapture *frame_capture = nullptr;
+
+        /// @brief Whether the capture frame begun by a job takes rows, owned by the worker thread.
+        bool capture_open = false;
+
+        /// @brief Frame buffer rectangles that changed since the last flush.
+        DamageList damage;
+
+        /// @brief Clear tracking of the whole screen.
+        ClearRecord screen_clear;
+
+        /// @brief Mutex protecting the flush job and the flush statistics.
+        mutable std::mutex flush_mutex;
+
+        /// @brief Notifies the worker thread that a new frame is waiting in the front buffer.
+        std::condition_variable flush_condvar;
+
+        /// @brief Notifies waiting callers that the worker took or finished a job.
+        std::condition_variable flush_done_condvar;
+
+        /// @brief Stop source for the worker thread, requested in the destructor.
+        std::stop_source stop_source;
+
+        /// @brief The job waiting for the worker, valid while flush_requested is set.
+        FlushJob flush_job;
+        bool flush_requested = false;
+        bool flush_running = false;
+        FlushStats flush_stats;
+
+        /// @brief A worker thread sending the front buffer to the display.
+        /// @note Declared last so it is joined before the members it uses are destroyed.
+        std::jthread worker;
+
         /// @brief Given a font type, returns the corresponding font descriptor.
         /// @param font The better user accessible font type.
         /// @return A pointer defined in font_types.h to the font descriptor.
@@ -168,15 +712,143 @@ class DisplayDriver {
             }
         }
 
-        /// @brief Checks whether a given pixel is within the bounds of the screen.
+        /// @brief Returns the render target the drawing primitives write to.
+        const RenderTarget &current_target() const { return target; }
+
+        /// @brief Checks whether a given pixel is within the bounds of the current target.
         bool in_bounds(int x, int y) const {
-            if (orientation == DisplayOrientation::Landscape) {
-                return (x >= 0 && x < screen_width && y >= 0 && y < screen_height);
+            const Rect &clip = current_target().clip;
+            return (x >= clip.x && x < clip.right() && y >= clip.y && y < clip.bottom());
+        }
+
+        /// @brief Whether scroll() uses the hardware scroll, only full resolution portrait does.
+        bool hardware_scroll() const {
+            return orientation == DisplayOrientation::Portrait && scale == 1;
+        }
 
-            } else {
-                return (y >= 0 && y < screen_width && x >= 0 && x < screen_height);
+        /// @brief Sets the screen dimensions, the render target and the panel MADCTL for the
+        /// current orientation and resolution.
+        /// @note Writes to the panel, the worker thread must be idle.
+        void apply_orientation();
+
+        /// @brief Draws a glyph without recording any damage.
+        /// @return The width of the drawn glyph.
+        int put_glyph(int x, int y, const font_descriptor_t *fdes, int glyph_index, Color color);
+
+        /// @brief Copies a surface into the current target without recording it.
+        /// @param keyed Whether pixels of the key color are left out.
+        void put_surface(int x, int y, const Surface &surface, bool keyed, uint16_t key);
+
+        /// @brief Returns a target covering part of the frame buffer in the current color mode.
+        /// @param clears Clear tracking of the clip, the whole screen one when damage is the
+        /// frame damage.
+        RenderTarget frame_target(const Rect &clip, DamageList *damage,
+                                  ClearRecord *clears = nullptr) {
+            if (clears == nullptr && damage == &this->damage) {
+                clears = &screen_clear;
+            }
+            if (color_mode == ColorMode::Indexed8) {
+                return RenderTarget{nullptr, screen_width, 0, clip, damage, index_fb, clears};
             }
+            return RenderTarget{fb, screen_width, 0, clip, damage, nullptr, clears};
         }
 
-        inline std::pair<int, int> map_coords(int x, int y);
+        /// @brief Shared part of draw_circle() and fill_circle().
+        void draw_circle_shape(int cx, int cy, int radius, Color color, bool filled);
+
+        /// @brief Returns the palette entry closest to an RGB565 color.
+        /// @details Entries tied to a slot are skipped while there are others, a pixel landing
+        /// on one would change with the theme.
+        uint8_t palette_index(uint16_t color) const;
+
+        /// @brief Returns the slot of a color when the palette has it, the closest entry if not.
+        uint8_t palette_index(Color color) const;
+
+        /// @brief Converts RGB565 pixels into the closest palette indices.
+        /// @param keyed Whether pixels of the key color are left out.
+        void quantize_rect(uint8_t *dst, int dst_stride, const uint16_t *src, int src_stride,
+                           int width, int height, bool keyed, uint16_t key) const;
+
+        /// @brief Maps every palette index to the entry closest to color blended over it.
+        /// @param lut DisplayConstants::Palette::Size entries, indices past the palette map to
+        /// themselves.
+        void blend_lut(uint8_t *lut, uint16_t color, uint16_t weight) const;
+
+        /// @brief Records a draw call when a frame is being recorded.
+        /// @return True if the command was recorded, false if the caller has to draw it now.
+        bool record(
+            const DrawCommand &command, std::string_view text = {},
+            std::span<const Point> points = {}
+        );
+
+        /// @brief Executes every command of a display list with the current target.
+        void replay(const DisplayList &list);
+
+        /// @brief Rasterizes the changes of the recorded frame and starts recording the next one.
+        void finish_recorded_frame();
+
+        /// @brief Returns the area a text covers, the same way draw_text() places the glyphs.
+        static Rect measure_text(
+            int x, int y, const font_descriptor_t *fdes, std::string_view text);
+
+        /// @brief Clips a rectangle and records it as damaged if the target tracks damage.
+        void mark_damage(Rect rect);
+
+        /// @brief Returns the hash of one tile of the frame buffer, used by the TileHash mode.
+        uint32_t tile_hash(int tile_x, int tile_y) const;
+
+        /// @brief Sends a command with its parameter bytes.
+        void send_command(uint16_t command, std::initializer_list<int> data = {});
+
+        /// @brief Programs the hardware scroll of a job and rotates the shadow to match.
+        /// @note Not thread safe, only called from the worker thread or while it is idle.
+        void apply_scroll(const ScrollArea &scroll);
+
+        /// @brief Programs the panel address window and starts a memory write.
+        /// @param rect The window in screen coordinates.
+        void set_window(const Rect &rect);
+
+        /// @brief Sends one rectangle of a buffer to the display.
+        /// @param buffer The buffer to read from, rows are screen_width pixels apart.
+        /// @param origin_y Screen row stored in the first buffer row.
+        /// @param rect The rectangle in screen coordinates.
+        /// @param mode Single or paired stores.
+        /// @return Number of stores to the data register.
+        /// @note Not thread safe, only called from the worker thread.
+        int write_rect(const uint16_t *buffer, int origin_y, const Rect &rect, BusMode mode);
+
+        /// @brief Same as write_rect() for Resolution::Half, every pixel is sent as a 2x2 block.
+        /// @note Not thread safe, only called from the worker thread.
+        int write_upscaled_rect(
+            const uint16_t *buffer, int origin_y, const Rect &rect, BusMode mode);
+
+        /// @brief Sends one rectangle to the panel memory rows it occupies while scrolled.
+        /// @details Same as write_rect(), except that a rectangle crossing the wrap of the scroll
+        /// area is split into two windows.
+        /// @note Not thread safe, only called from the worker thread.
+        int write_scrolled_rect(
+            const uint16_t *buffer, int origin_y, const Rect &rect, BusMode mode);
+
+        /// @brief Sends the tiles of a rectangle that differ from the shadow buffer.
+        /// @param rect The damaged rectangle in screen coordinates.
+        /// @param mode Single or paired stores.
+        /// @param stats Statistics updated with the sent pixels.
+        /// @note Not thread safe, only called from the worker thread.
+        void write_changed_tiles(const Rect &rect, BusMode mode, FlushStats &stats);
+
+        /// @brief Replaces the damage with the tiles whose hash changed since the last flush.
+        void drop_unchanged_tiles();
+
+        /// @brief Stores the capture rows of a job in its frame capture, worker thread only.
+        void capture_rows(const FlushJob &job);
+
+        /// @brief Stores a frame buffer row in a frame capture at the panel resolution.
+        void capture_row(FrameCapture &capture, int y, const uint16_t *row);
+
+        /// @brief Hands a job to the worker thread, waits until the previous job was taken.
+        void submit_flush_job(const FlushJob &job);
+
+        /// @brief The main loop of the worker thread.
+        /// @param stop_token This token is used by the jthread to stop the thread.
+        void flush_thread_loop(std::stop_token stop_token);
 };
@@ -0,0 +1,206 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 Matyas Godula
+
+/// @file MemoryBackend.hpp
+/// @brief Panel backend keeping an emulated HX8357 frame memory, for running without the board.
+/// @author Matyas Godula
+/// @date 17.10.2026
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+
+/// @brief Model of the HX8357 commands the DisplayDriver uses.
+/// @details Understands the column and page address set, memory write, MADCTL and the vertical
+/// scroll commands, everything else is ignored. pixel() returns what the panel would show, so
+/// the flush code can be checked on a host without the board.
+class MemoryBackend {
+    public:
+        static constexpr int Columns = 320; ///< Native columns of the panel memory
+        static constexpr int Rows = 480;    ///< Native rows, the hardware scroll moves along them
+
+        /// @brief Time the board spends on the PARLCD bus.
+        struct BusCost {
+            double store_ns = 0; ///< Every store to a PARLCD register, commands included.
+            double pixel_ns = 0; ///< Every pixel shifted out to the panel.
+        };
+
+        MemoryBackend() : memory(std::make_unique<uint16_t[]>(Columns * Rows)) {}
+
+        /// @brief Same state as after parlcd_hx8357_init(), the memory keeps its contents.
+        void reset() {
+            madctl = 0xE8;
+            first_column = 0;
+            last_column = Rows - 1;
+            first_page = 0;
+            last_page = Columns - 1;
+            top_fixed = 0;
+            scroll_lines = Rows;
+            scroll_start = 0;
+        }
+
+        void command(uint16_t command) {
+            charge(bus_cost.store_ns);
+            current = command;
+            argument_count = 0;
+            if (command == 0x2C) {
+                column = first_column;
+                page = first_page;
+            }
+        }
+
+        /// @brief Writes a parameter of the last command, or a pixel after a memory write.
+        void data(uint16_t value) {
+            if (current == 0x2C) {
+                write16(value);
+                return;
+            }
+            charge(bus_cost.store_ns);
+            if (argument_count < MaxArguments) {
+                arguments[argument_count] = value;
+            }
+            ++argument_count;
+            switch (current) {
+            case 0x2A:
+                if (argument_count == 4) {
+                    first_column = argument(0);
+                    last_column = argument(2);
+                }
+                break;
+            case 0x2B:
+                if (argument_count == 4) {
+                    first_page = argument(0);
+                    last_page = argument(2);
+                }
+                break;
+            case 0x33:
+                if (argument_count == 6) {
+                    top_fixed = argument(0);
+                    scroll_lines = argument(2);
+                }
+                break;
+            case 0x36:
+                madctl = value;
+                break;
+            case 0x37:
+                if (argument_count == 2) {
+                    scroll_start = argument(0);
+                }
+                break;
+            default:
+                break;
+            }
+        }
+
+        void write16(uint16_t pixel) {
+            charge(bus_cost.store_ns + bus_cost.pixel_ns);
+            stream(pixel);
+        }
+
+        void write32(uint32_t pixels) {
+            charge(bus_cost.store_ns + 2 * bus_cost.pixel_ns);
+            stream(static_cast<uint16_t>(pixels));
+            stream(static_cast<uint16_t>(pixels >> 16));
+        }
+
+        /// @brief Makes every bus access take as long as on the board, zero costs turn it off.
+        /// @details The time is spent spinning on the thread writing to the backend, so the
+        /// timings of a host build (FlushStats, overlap of drawing and flushing) follow the board.
+        void set_bus_cost(const BusCost &cost) { bus_cost = cost; }
+
+        /// @brief Width of the screen in the orientation set by MADCTL.
+        int width() const { return (madctl & RowColumnExchange) ? Rows : Columns; }
+
+        /// @brief Height of the screen in the orientation set by MADCTL.
+        int height() const { return (madctl & RowColumnExchange) ? Columns : Rows; }
+
+        /// @brief The pixel the panel shows at a screen position, scrolling included.
+        uint16_t pixel(int x, int y) const {
+            int column = 0, row = 0;
+            locate(x, y, column, row);
+            return memory[visible_row(row) * Columns + column];
+        }
+
+        /// @brief Number of pixels written since the backend was created.
+        long pixels() const { return pixels_written; }
+
+    private:
+        static constexpr int MaxArguments = 8;
+        static constexpr uint16_t RowColumnExchange = 0x20;
+        static constexpr uint16_t ColumnMirror = 0x40;
+        static constexpr uint16_t RowMirror = 0x80;
+
+        std::unique_ptr<uint16_t[]> memory;
+        uint16_t current = 0;
+        uint16_t arguments[MaxArguments] = {};
+        int argument_count = 0;
+        uint16_t madctl = 0xE8;
+        int first_column = 0, last_column = Rows - 1;
+        int first_page = 0, last_page = Columns - 1;
+        int column = 0, page = 0;
+        int top_fixed = 0, scroll_lines = Rows, scroll_start = 0;
+        long pixels_written = 0;
+
+        /// @brief Bus time is paid in bursts, reading the clock on every store would cost more
+        /// than the stores themselves.
+        static constexpr double BurstNs = 20000;
+        BusCost bus_cost;
+        double owed_ns = 0;
+        std::chrono::steady_clock::time_point burst_start;
+
+        void charge(double ns) {
+            if (ns <= 0) {
+                return;
+            }
+            if (owed_ns == 0) {
+                burst_start = std::chrono::steady_clock::now();
+            }
+            owed_ns += ns;
+            if (owed_ns >= BurstNs) {
+                auto end = burst_start + std::chrono::nanoseconds(static_cast<long>(owed_ns));
+                while (std::chrono::steady_clock::now() < end) {
+                }
+                owed_ns = 0;
+            }
+        }
+
+        /// @brief Stores a pixel at the cursor and advances it through the window.
+        void stream(uint16_t pixel) {
+            store(column, page, pixel);
+            ++pixels_written;
+            if (++column > last_column) {
+                column = first_column;
+                ++page;
+            }
+        }
+
+        /// @brief A big endian parameter pair starting at index.
+        int argument(int index) const { return arguments[index] << 8 | arguments[index + 1]; }
+
+        /// @brief Maps an addressed column and page to the native memory column and row.
+        void locate(int x, int y, int &column, int &row) const {
+            int across = (madctl & RowColumnExchange) ? y : x;
+            int along = (madctl & RowColumnExchange) ? x : y;
+            column = (madctl & ColumnMirror) ? Columns - 1 - across : across;
+            row = (madctl & RowMirror) ? Rows - 1 - along : along;
+        }
+
+        void store(int x, int y, uint16_t pixel) {
+            int column = 0, row = 0;
+            locate(x, y, column, row);
+            if (column >= 0 && column < Columns && row >= 0 && row < Rows) {
+                memory[row * Columns + column] = pixel;
+            }
+        }
+
+        /// @brief The memory row shown on a scan line, the scroll area wraps around.
+        int visible_row(int line) const {
+            if (line < top_fixed || line >= top_fixed + scroll_lines) {
+                return line;
+            }
+            int shifted = scroll_start - top_fixed + line - top_fixed;
+            return top_fixed + (shifted % scroll_lines + scroll_lines) % scroll_lines;
+        }
+};
@@ -0,0 +1,19 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 Matyas Godula
+
+/// @file PanelBackend.hpp
+/// @brief Compile time choice of where the DisplayDriver sends its panel traffic.
+/// @author Matyas Godula
+/// @date 17.10.2026
+/// @note Selected by the Makefile (DISPLAY_BACKEND=parlcd|memory). The driver holds the
+/// backend by value, so every pixel store is an inlined call and there is no virtual dispatch.
+
+#pragma once
+
+#if defined(DISPLAY_BACKEND_MEMORY)
+#include "include/drivers/MemoryBackend.hpp"
+using PanelBackend = MemoryBackend;
+#else
+#include "include/drivers/ParlcdBackend.hpp"
+using PanelBackend = ParlcdBackend;
+#endif
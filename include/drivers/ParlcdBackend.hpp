@@ -0,0 +1,51 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 Matyas Godula
+
+/// @file ParlcdBackend.hpp
+/// @brief Panel backend writing to the PARLCD registers of the MZ-APO board.
+/// @author Matyas Godula
+/// @date 17.10.2026
+
+#pragma once
+
+#include "third_party/mzapo/mzapo_parlcd.h"
+#include "third_party/mzapo/mzapo_phys.h"
+#include "third_party/mzapo/mzapo_regs.h"
+
+#include <cstdint>
+#include <stdexcept>
+
+/// @brief The real HX8357 panel behind the memory mapped PARLCD peripheral.
+/// @details Pixels are stored straight into the data register, so the flush loop has no calls.
+class ParlcdBackend {
+    public:
+        /// @throw std::runtime_error if the physical address mapping fails.
+        ParlcdBackend() {
+            base = static_cast<uint8_t *>(
+                map_phys_address(PARLCD_REG_BASE_PHYS, PARLCD_REG_SIZE, 0));
+            if (base == nullptr) {
+                throw std::runtime_error("Failed to map physical address");
+            }
+            data16 = reinterpret_cast<volatile uint16_t *>(base + PARLCD_REG_DATA_o);
+            data32 = reinterpret_cast<volatile uint32_t *>(base + PARLCD_REG_DATA_o);
+        }
+
+        /// @brief Resets and initializes the panel, it ends up in landscape without scrolling.
+        void reset() { parlcd_hx8357_init(base); }
+
+        void command(uint16_t command) { parlcd_write_cmd(base, command); }
+
+        /// @brief Writes a parameter of the last command.
+        void data(uint16_t value) { parlcd_write_data(base, value); }
+
+        /// @brief Writes one pixel of a memory write.
+        void write16(uint16_t pixel) { *data16 = pixel; }
+
+        /// @brief Writes two pixels of a memory write, the lower half is assumed to go first.
+        void write32(uint32_t pixels) { *data32 = pixels; }
+
+    private:
+        uint8_t *base;
+        volatile uint16_t *data16;
+        volatile uint32_t *data32;
+};
@@ -0,0 +1,42 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 Matyas Godula
+
+/// @file Image.hpp
+/// @brief Non owning view of a full color RGB565 image.
+/// @author Matyas Godula
+/// @date 17.10.2026
+/// @note Unlike a Sprite the pixels are plain memory, so they can be copied row by row.
+
+#pragma once
+
+#include <cstdint>
+
+/// @brief A rectangular RGB565 image stored row-major in memory owned by someone else.
+/// @details Works for constexpr arrays as well as buffers loaded at runtime, the memory has to
+/// outlive every draw call using the image (until flush() in the recorded draw mode).
+struct Image {
+    int width = 0;                    ///< Width of the image in pixels
+    int height = 0;                   ///< Height of the image in pixels
+    const uint16_t *pixels = nullptr; ///< The top left pixel
+    int stride = 0;                   ///< Distance between two rows in pixels
+    uint32_t version = 0;             ///< Bumped by the owner whenever it rewrites the pixels
+
+    constexpr Image() = default;
+
+    /// @brief Creates a view of an image.
+    /// @param width Width of the image in pixels.
+    /// @param height Height of the image in pixels.
+    /// @param pixels The top left pixel, rows follow each other stride pixels apart.
+    /// @param stride Distance between two rows in pixels, 0 for tightly packed rows.
+    /// @param version Changes whenever the pixels are rewritten, recorded frames compare it
+    /// instead of reading the pixels. Constant images keep 0.
+    /// @note A view of a part of a bigger image is made by pointing pixels into it and passing the
+    /// stride of the bigger image.
+    constexpr Image(int width, int height, const uint16_t *pixels, int stride = 0,
+                    uint32_t version = 0)
+        : width(width), height(height), pixels(pixels), stride(stride ? stride : width),
+          version(version) {}
+
+    /// @brief Returns the first pixel of a row.
+    constexpr const uint16_t *row(int y) const { return pixels + y * stride; }
+};
@@ -15,6 +15,11 @@ struct Sprite {
     int width;   ///< Width of the sprite in pixels
     int height;  ///< Height of the sprite in pixels
 
+    /// @brief Changes whenever at() starts returning different pixels.
+    /// @details Recorded frames compare it instead of reading the pixels, sprites that change
+    /// (e.g. a damaged shield) have to bump it on every change.
+    uint32_t version = 0;
+
     /// @brief Retrieves the pixel value at a given coordinate.
     /// @param x The x-coordinate of the pixel (0 <= x < width).
     /// @param y The y-coordinate of the pixel (0 <= y < height).
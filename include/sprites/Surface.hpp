@@ -0,0 +1,71 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 Matyas Godula
+
+/// @file Surface.hpp
+/// @brief Offscreen pixel buffer the DisplayDriver can draw into and copy onto the screen.
+/// @author Matyas Godula
+/// @date 17.10.2026
+/// @note Drawn with DisplayDriver::draw_to(), copied with DisplayDriver::draw_surface().
+
+#pragma once
+
+#include "include/sprites/Image.hpp"
+#include "include/utils/Color.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+
+class DisplayDriver;
+
+/// @brief An owned buffer with the pixel format of a frame buffer.
+/// @details Static content such as labels is drawn into a surface once with the usual draw_*
+/// calls and then copied into every frame, a copy per row instead of rasterizing glyph by glyph.
+/// An Indexed8 surface holds palette indices of the DisplayDriver palette, so it is copied into
+/// the indexed frame buffer as it is.
+class Surface {
+    public:
+        /// @param width Width in pixels.
+        /// @param height Height in pixels.
+        /// @param mode Rgb565 can hold images and blending, Indexed8 matches the indexed mode.
+        /// @note The pixels start out zero, black or the first palette entry.
+        Surface(int width, int height, ColorMode mode = ColorMode::Rgb565)
+            : width(std::max(width, 0)), height(std::max(height, 0)), mode(mode) {
+            if (mode == ColorMode::Indexed8) {
+                indices = std::make_unique<uint8_t[]>(this->width * this->height);
+            } else {
+                pixels = std::make_unique<uint16_t[]>(this->width * this->height);
+            }
+        }
+
+        int get_width() const { return width; }
+
+        int get_height() const { return height; }
+
+        ColorMode get_color_mode() const { return mode; }
+
+        /// @brief Counts the DisplayDriver::draw_to() calls, recorded frames compare it instead
+        /// of the pixels.
+        uint32_t get_version() const { return version; }
+
+        /// @brief The pixels as an image, empty for an Indexed8 surface.
+        Image image() const {
+            return pixels ? Image(width, height, pixels.get(), 0, version) : Image();
+        }
+
+        /// @brief Returns the first pixel of a row of an Rgb565 surface.
+        const uint16_t *row(int y) const { return pixels.get() + y * width; }
+
+        /// @brief Returns the first index of a row of an Indexed8 surface.
+        const uint8_t *index_row(int y) const { return indices.get() + y * width; }
+
+    private:
+        friend class DisplayDriver;
+
+        int width;
+        int height;
+        ColorMode mode;
+        uint32_t version = 0;
+        std::unique_ptr<uint16_t[]> pixels;
+        std::unique_ptr<uint8_t[]> indices;
+};
@@ -26,9 +26,34 @@ struct Color {
         /// @param b Blue component (0-255)
         constexpr Color(uint8_t r, uint8_t g, uint8_t b) : value(to565(r, g, b)) {}
 
+        /// @brief Creates a color from an already packed RGB565 value.
+        static constexpr Color from_rgb565(uint16_t value) {
+            Color color(0, 0, 0);
+            color.value = value;
+            return color;
+        }
+
         /// @brief Gets the RGB565 color as a uint16_t.
         constexpr uint16_t to_rgb565() const { return value; }
 
+        /// @brief Slot of a color that is not tied to a palette entry.
+        static constexpr uint8_t NoSlot = 0xFF;
+
+        /// @brief Returns the same color tied to a palette entry.
+        /// @details The indexed color mode of the DisplayDriver draws it with that entry instead
+        /// of looking the color up, so the pixels follow the entry when the palette changes. The
+        /// theme colors are tied to the entries theme_palette() puts them at.
+        constexpr Color in_slot(uint8_t palette_entry) const {
+            Color color = *this;
+            color.slot = palette_entry;
+            return color;
+        }
+
+        /// @brief Gets the palette entry the color is tied to, NoSlot if there is none.
+        constexpr uint8_t get_slot() const { return slot; }
+
+        constexpr bool operator==(const Color &) const = default;
+
         static const Color White;
         static const Color Black;
         static const Color Red;
@@ -40,6 +65,7 @@ struct Color {
 
     private:
         uint16_t value;
+        uint8_t slot = NoSlot;
 
         /// @brief Converts RGB888 values to RGB565 format.
         /// @param r Red component (0-255)
@@ -68,4 +94,10 @@ constexpr Color Color::Green = Color(0, 255, 0);
 constexpr Color Color::Blue = Color(0, 0, 255);
 constexpr Color Color::Yellow = Color(255, 255, 0);
 constexpr Color Color::Cyan = Color(0, 255, 255);
-constexpr Color Color::Magenta = Color(255, 0, 255);
\ No newline at end of file
+constexpr Color Color::Magenta = Color(255, 0, 255);
+
+/// @brief ColorMode enum for the pixel format of the frame buffer and of surfaces.
+enum class ColorMode : uint8_t {
+    Rgb565,   ///< 16-bit pixels, every color can be drawn.
+    Indexed8, ///< 8-bit palette indices expanded to RGB565 in flush(), half the memory traffic.
+};
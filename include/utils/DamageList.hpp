@@ -0,0 +1,96 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 Matyas Godula
+
+/// @file DamageList.hpp
+/// @brief Fixed capacity list of damaged screen rectangles.
+/// @author Matyas Godula
+/// @date 17.10.2026
+
+#pragma once
+
+#include "include/utils/Rect.hpp"
+
+/// @brief Heapless list of rectangles that need to be sent to the display.
+/// @details Rectangles are merged whenever the union does not cover more pixels than the two
+/// rectangles separately. When the list is full the new rectangle is merged into the entry whose
+/// area grows the least, so the list always covers every added pixel.
+class DamageList {
+    public:
+        static constexpr int Capacity = 16;
+
+        /// @brief Adds a rectangle to the list, merging it with existing entries if possible.
+        /// @param rect The damaged rectangle, empty rectangles are ignored.
+        void add(Rect rect) {
+            if (rect.empty()) {
+                return;
+            }
+
+            // Merging can make the rectangle touch other entries, so keep merging until it settles.
+            bool merged = true;
+            while (merged) {
+                merged = false;
+                for (int i = 0; i < count; ++i) {
+                    if (rects[i].contains(rect)) {
+                        return;
+                    }
+                    Rect united = rects[i].unite(rect);
+                    if (united.area() <= rects[i].area() + rect.area()) {
+                        rect = united;
+                        remove(i);
+                        merged = true;
+                        break;
+                    }
+                }
+            }
+
+            if (count < Capacity) {
+                rects[count++] = rect;
+                return;
+            }
+
+            int best = 0;
+            int best_growth = rects[0].unite(rect).area() - rects[0].area();
+            for (int i = 1; i < count; ++i) {
+                int growth = rects[i].unite(rect).area() - rects[i].area();
+                if (growth < best_growth) {
+                    best = i;
+                    best_growth = growth;
+                }
+            }
+            rect = rects[best].unite(rect);
+            remove(best);
+            add(rect);
+        }
+
+        /// @brief Adds every rectangle of another list.
+        void add(const DamageList &other) {
+            for (const Rect &rect : other) {
+                add(rect);
+            }
+        }
+
+        void clear() { count = 0; }
+
+        bool empty() const { return count == 0; }
+
+        int size() const { return count; }
+
+        /// @brief Smallest rectangle containing every entry.
+        Rect bounds() const {
+            Rect result{};
+            for (const Rect &rect : *this) {
+                result = result.unite(rect);
+            }
+            return result;
+        }
+
+        const Rect *begin() const { return rects; }
+
+        const Rect *end() const { return rects + count; }
+
+    private:
+        Rect rects[Capacity];
+        int count = 0;
+
+        void remove(int index) { rects[index] = rects[--count]; }
+};
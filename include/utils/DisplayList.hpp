@@ -0,0 +1,211 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 Matyas Godula
+
+/// @file DisplayList.hpp
+/// @brief Fixed capacity list of recorded draw commands.
+/// @author Matyas Godula
+/// @date 17.10.2026
+
+#pragma once
+
+#include "include/utils/Color.hpp"
+#include "include/utils/DamageList.hpp"
+#include "include/utils/Point.hpp"
+#include "include/utils/Rect.hpp"
+
+#include "include/sprites/Image.hpp"
+#include "include/sprites/Sprite.hpp"
+#include "include/sprites/Surface.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+/// @brief A single recorded draw call.
+struct DrawCommand {
+    enum class Kind : uint8_t {
+        Pixel,
+        Rectangle,
+        Letter,
+        Text,
+        Sprite,
+        Fill,
+        Image,
+        KeyedImage,
+        BlendRectangle,
+        BlendImage,
+        Fade,
+        Line,
+        Circle,
+        FilledCircle,
+        Polygon,
+        Surface,
+        KeyedSurface,
+    };
+
+    Kind kind = Kind::Pixel;
+    uint8_t font = 0;      ///< FontType of letters and texts.
+    uint8_t alpha = 255;   ///< Opacity of the blended kinds.
+    Color color = Color::Black; ///< With its palette slot, the transparent color of keyed images.
+    Rect area;             ///< Requested position and size, everything the call may touch.
+    int text_offset = 0;   ///< Start of the text in the text storage of the list.
+    int text_length = 0;   ///< Length of the text, a letter is stored as a text of length one.
+    int point_offset = 0;  ///< Start of the vertices in the point storage of the list.
+    int point_count = 0;   ///< Number of vertices, the end points of a line are two vertices.
+    const Sprite *sprite = nullptr;
+    Image image;           ///< Copied, the caller's Image may be a temporary.
+    const Surface *surface = nullptr;
+    uint32_t hash = 0;     ///< Hash of everything above including text and versions.
+};
+
+/// @brief Heapless list of draw commands recorded over one frame.
+/// @details Texts and vertices are copied into the list, so the commands stay valid after the
+/// caller's strings and arrays are gone. Comparing two lists gives the exact areas that differ
+/// between two frames.
+class DisplayList {
+    public:
+        static constexpr int Capacity = 512;
+        static constexpr int TextCapacity = 2048;
+        static constexpr int PointCapacity = 1024;
+
+        /// @brief Appends a command, hashing it together with its text and vertices.
+        /// @param command The command to add, its text, point and hash fields are filled in here.
+        /// @param text The text of letter and text commands.
+        /// @param points The vertices of line and polygon commands.
+        /// @return False if the list, the text or the point storage is full, the command is not
+        /// added then.
+        bool add(
+            DrawCommand command, std::string_view text = {}, std::span<const Point> points = {}
+        ) {
+            if (count == Capacity || text_used + static_cast<int>(text.size()) > TextCapacity ||
+                points_used + static_cast<int>(points.size()) > PointCapacity) {
+                return false;
+            }
+            if (command.kind == DrawCommand::Kind::BlendRectangle ||
+                command.kind == DrawCommand::Kind::BlendImage ||
+                command.kind == DrawCommand::Kind::Fade) {
+                blending = true;
+            }
+            command.text_offset = text_used;
+            command.text_length = static_cast<int>(text.size());
+            text.copy(texts + text_used, text.size());
+            text_used += command.text_length;
+            command.point_offset = points_used;
+            command.point_count = static_cast<int>(points.size());
+            std::copy(points.begin(), points.end(), vertices + points_used);
+            points_used += command.point_count;
+
+            uint32_t hash = 2166136261u; // FNV-1a
+            auto mix = [&hash](uint32_t value) {
+                for (int i = 0; i < 4; ++i) {
+                    hash = (hash ^ ((value >> (8 * i)) & 0xFF)) * 16777619u;
+                }
+            };
+            mix(static_cast<uint32_t>(command.kind) | command.font << 8 |
+                command.color.to_rgb565() << 16);
+            mix(command.alpha | command.color.get_slot() << 8);
+            mix(command.area.x);
+            mix(command.area.y);
+            mix(command.area.width);
+            mix(command.area.height);
+            for (char ch : text) {
+                hash = (hash ^ static_cast<uint8_t>(ch)) * 16777619u;
+            }
+            for (const Point &point : points) {
+                mix(point.x);
+                mix(point.y);
+            }
+            // Sprites, surfaces and images change between frames (shields get shot), their
+            // versions tell without reading the pixels.
+            if (command.sprite != nullptr) {
+                mix(command.sprite->version);
+            }
+            if (command.surface != nullptr) {
+                mix(command.surface->get_version());
+            }
+            mix(command.image.version);
+            command.hash = hash;
+            commands[count++] = command;
+            return true;
+        }
+
+        void clear() {
+            count = 0;
+            text_used = 0;
+            points_used = 0;
+            blending = false;
+        }
+
+        bool empty() const { return count == 0; }
+
+        int size() const { return count; }
+
+        /// @brief Whether a command blends with the pixels underneath it.
+        /// @note Blending twice gives a different result, such a list can only be replayed over
+        /// an area it clears first.
+        bool blends() const { return blending; }
+
+        std::string_view text(const DrawCommand &command) const {
+            return std::string_view(texts + command.text_offset, command.text_length);
+        }
+
+        std::span<const Point> points(const DrawCommand &command) const {
+            return std::span<const Point>(vertices + command.point_offset, command.point_count);
+        }
+
+        /// @brief Collects the areas that differ between a previous frame and this one.
+        /// @param previous The list of the previous frame.
+        /// @param changes Receives the areas of every command that is not shared.
+        /// @details The common prefix and suffix of both lists draw the same pixels in the same
+        /// order, so only the commands in between can change a pixel.
+        void diff(const DisplayList &previous, DamageList &changes) const {
+            int prefix = 0;
+            while (prefix < count && prefix < previous.count &&
+                   same(commands[prefix], previous, previous.commands[prefix])) {
+                ++prefix;
+            }
+            int suffix = 0;
+            while (suffix < count - prefix && suffix < previous.count - prefix &&
+                   same(commands[count - 1 - suffix], previous,
+                        previous.commands[previous.count - 1 - suffix])) {
+                ++suffix;
+            }
+
+            for (int i = prefix; i < count - suffix; ++i) {
+                changes.add(commands[i].area);
+            }
+            for (int i = prefix; i < previous.count - suffix; ++i) {
+                changes.add(previous.commands[i].area);
+            }
+        }
+
+        const DrawCommand *begin() const { return commands; }
+
+        const DrawCommand *end() const { return commands + count; }
+
+    private:
+        DrawCommand commands[Capacity];
+        int count = 0;
+        char texts[TextCapacity];
+        int text_used = 0;
+        Point vertices[PointCapacity];
+        int points_used = 0;
+        bool blending = false;
+
+        /// @brief Checks whether a command of this list draws the same as one of another list.
+        bool same(const DrawCommand &command, const DisplayList &other,
+                  const DrawCommand &other_command) const {
+            return command.hash == other_command.hash && command.kind == other_command.kind &&
+                   command.font == other_command.font && command.color == other_command.color &&
+                   command.alpha == other_command.alpha &&
+                   command.area == other_command.area &&
+                   command.sprite == other_command.sprite &&
+                   command.surface == other_command.surface &&
+                   command.image.pixels == other_command.image.pixels &&
+                   command.image.stride == other_command.image.stride &&
+                   command.image.version == other_command.image.version &&
+                   text(command) == other.text(other_command) &&
+                   std::ranges::equal(points(command), other.points(other_command));
+        }
+};
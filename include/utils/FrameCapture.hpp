@@ -0,0 +1,189 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 Matyas Godula
+
+/// @file FrameCapture.hpp
+/// @brief Streams flushed frames into a file, as PPM images or raw RGB565.
+/// @author Matyas Godula
+/// @date 17.10.2026
+
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+/// @brief CaptureFormat enum for the layout of the captured frames.
+enum class CaptureFormat : uint8_t {
+    Ppm,    ///< Binary PPM images one after another, e.g. ffmpeg -f image2pipe -c:v ppm reads them.
+    Rgb565, ///< A CaptureHeader followed by the little endian RGB565 pixels of the frame.
+};
+
+/// @brief Header of every frame of CaptureFormat::Rgb565.
+struct CaptureHeader {
+    char magic[4] = {'F', '5', '6', '5'};
+    uint32_t frame = 0; ///< Number of the flush, frames that were not captured leave a gap.
+    uint16_t width = 0;
+    uint16_t height = 0;
+    uint32_t reserved = 0;
+};
+
+/// @brief Appends frames to a file through a shared mapping.
+/// @details The file is grown and mapped a chunk of many frames at a time, the rows are copied in
+/// and the kernel writes them back later, so a frame costs a copy and no system calls. The file is
+/// cut back to the captured frames when the capture is destroyed. PPM frames carry their number in
+/// a comment line.
+class FrameCapture {
+    public:
+        /// @param path The file to create, an existing one is truncated.
+        /// @param format How the frames are stored.
+        /// @param changed_only Skip flushes that did not change the screen.
+        /// @throw std::runtime_error if the file can not be created.
+        FrameCapture(const char *path, CaptureFormat format, bool changed_only = false)
+            : format(format), changed_only(changed_only) {
+            fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+            if (fd < 0) {
+                throw std::runtime_error("Failed to create the capture file");
+            }
+        }
+
+        ~FrameCapture() {
+            if (mapping != nullptr) {
+                munmap(mapping, mapping_size);
+            }
+            if (fd >= 0) {
+                // Drop the unused rest of the last chunk.
+                if (ftruncate(fd, end) != 0) {
+                    std::cout << "Frame capture could not be trimmed\n";
+                }
+                close(fd);
+            }
+        }
+
+        FrameCapture(const FrameCapture &) = delete;
+        FrameCapture &operator=(const FrameCapture &) = delete;
+
+        /// @brief Starts the frame of a flush.
+        /// @param changed Whether the flush changes anything on the screen.
+        /// @return False if the frame is skipped, write_row() and end_frame() must not be called.
+        bool begin_frame(int width, int height, bool changed) {
+            uint32_t number = flushes++;
+            if (fd < 0 || (changed_only && !changed)) {
+                return false;
+            }
+
+            char header[64];
+            int header_size = 0;
+            if (format == CaptureFormat::Ppm) {
+                header_size = std::snprintf(header, sizeof(header), "P6\n# frame %u\n%d %d\n255\n",
+                                            number, width, height);
+                bytes_per_pixel = 3;
+            } else {
+                CaptureHeader frame_header;
+                frame_header.frame = number;
+                frame_header.width = static_cast<uint16_t>(width);
+                frame_header.height = static_cast<uint16_t>(height);
+                std::memcpy(header, &frame_header, sizeof(frame_header));
+                header_size = sizeof(frame_header);
+                bytes_per_pixel = 2;
+            }
+
+            off_t frame_size = header_size + static_cast<off_t>(width) * height * bytes_per_pixel;
+            if (end + frame_size > mapping_start + static_cast<off_t>(mapping_size) &&
+                !map_chunk(frame_size)) {
+                fail();
+                return false;
+            }
+            uint8_t *frame = mapping + (end - mapping_start);
+            std::memcpy(frame, header, header_size);
+            pixels = frame + header_size;
+            row_bytes = width * bytes_per_pixel;
+            end += frame_size;
+            return true;
+        }
+
+        /// @brief Stores a row of the frame started by begin_frame(), rows may come in any order.
+        void write_row(int y, const uint16_t *row, int width) {
+            uint8_t *dst = pixels + y * row_bytes;
+            if (format == CaptureFormat::Rgb565) {
+                std::memcpy(dst, row, width * sizeof(uint16_t));
+                return;
+            }
+            for (int x = 0; x < width; ++x) {
+                uint16_t pixel = row[x];
+                int red = pixel >> 11, green = (pixel >> 5) & 0x3F, blue = pixel & 0x1F;
+                // Repeating the top bits spreads 0..31 over the whole 0..255 range.
+                *dst++ = static_cast<uint8_t>(red << 3 | red >> 2);
+                *dst++ = static_cast<uint8_t>(green << 2 | green >> 4);
+                *dst++ = static_cast<uint8_t>(blue << 3 | blue >> 2);
+            }
+        }
+
+        /// @brief Finishes the frame, the kernel writes it back with the rest of the chunk.
+        void end_frame() { ++captured; }
+
+        /// @brief Number of frames stored in the file.
+        int frames() const { return captured; }
+
+    private:
+        /// @brief Bytes the file grows by at once, about 50 full screen RGB565 frames.
+        static constexpr off_t ChunkSize = 16 << 20;
+
+        int fd = -1;
+        CaptureFormat format;
+        bool changed_only;
+        uint32_t flushes = 0;
+        int captured = 0;
+        off_t end = 0;           ///< End of the captured frames, the next frame starts here.
+        off_t mapping_start = 0; ///< File offset of the mapping.
+        uint8_t *mapping = nullptr;
+        size_t mapping_size = 0;
+        uint8_t *pixels = nullptr;
+        int bytes_per_pixel = 2;
+        int row_bytes = 0;
+
+        /// @brief Grows the file by a chunk and maps it from the page holding end.
+        /// @param frame_size The chunk has to hold at least a frame of this size.
+        bool map_chunk(off_t frame_size) {
+            if (mapping != nullptr) {
+                munmap(mapping, mapping_size);
+                mapping = nullptr;
+            }
+            // Mappings start on a page, the previous frame may end in the middle of one.
+            mapping_start = end - end % sysconf(_SC_PAGESIZE);
+            off_t size = std::max(ChunkSize, end + frame_size - mapping_start);
+            if (ftruncate(fd, mapping_start + size) != 0) {
+                return false;
+            }
+            void *memory =
+                mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, mapping_start);
+            if (memory == MAP_FAILED) {
+                return false;
+            }
+            mapping = static_cast<uint8_t *>(memory);
+            mapping_size = size;
+            return true;
+        }
+
+        /// @brief Stops capturing, a full disk should not stop the game.
+        void fail() {
+            std::cout << "Frame capture failed, capturing stopped\n";
+            if (mapping != nullptr) {
+                munmap(mapping, mapping_size);
+                mapping = nullptr;
+            }
+            mapping_size = 0;
+            // Keep only the frames that made it in.
+            if (ftruncate(fd, end) != 0) {
+                std::cout << "Frame capture could not be trimmed\n";
+            }
+            close(fd);
+            fd = -1;
+        }
+};
@@ -0,0 +1,17 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 Matyas Godula
+
+/// @file Point.hpp
+/// @brief Integer point on the screen, used for the vertices of lines and polygons.
+/// @author Matyas Godula
+/// @date 17.10.2026
+
+#pragma once
+
+/// @brief A pixel position, x grows to the right and y grows down.
+struct Point {
+    int x = 0;
+    int y = 0;
+
+    constexpr bool operator==(const Point &other) const = default;
+};
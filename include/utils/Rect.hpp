@@ -0,0 +1,65 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 Matyas Godula
+
+/// @file Rect.hpp
+/// @brief Axis aligned rectangle used for clipping and damage tracking.
+/// @author Matyas Godula
+/// @date 17.10.2026
+
+#pragma once
+
+#include <algorithm>
+
+/// @brief Axis aligned rectangle given by its top left corner and its size.
+/// @note A rectangle with a non positive width or height is considered empty.
+struct Rect {
+    int x = 0;
+    int y = 0;
+    int width = 0;
+    int height = 0;
+
+    constexpr bool empty() const { return width <= 0 || height <= 0; }
+
+    /// @brief One past the last column of the rectangle.
+    constexpr int right() const { return x + width; }
+
+    /// @brief One past the last row of the rectangle.
+    constexpr int bottom() const { return y + height; }
+
+    constexpr int area() const { return empty() ? 0 : width * height; }
+
+    /// @brief Returns the overlapping part of two rectangles, empty if they do not overlap.
+    constexpr Rect intersect(const Rect &other) const {
+        int left = std::max(x, other.x);
+        int top = std::max(y, other.y);
+        int new_right = std::min(right(), other.right());
+        int new_bottom = std::min(bottom(), other.bottom());
+        if (new_right <= left || new_bottom <= top) {
+            return Rect{};
+        }
+        return Rect{left, top, new_right - left, new_bottom - top};
+    }
+
+    /// @brief Returns the smallest rectangle containing both rectangles.
+    /// @note Empty rectangles are ignored.
+    constexpr Rect unite(const Rect &other) const {
+        if (empty()) {
+            return other;
+        }
+        if (other.empty()) {
+            return *this;
+        }
+        int left = std::min(x, other.x);
+        int top = std::min(y, other.y);
+        int new_right = std::max(right(), other.right());
+        int new_bottom = std::max(bottom(), other.bottom());
+        return Rect{left, top, new_right - left, new_bottom - top};
+    }
+
+    constexpr bool contains(const Rect &other) const {
+        return !empty() && other.x >= x && other.y >= y && other.right() <= right() &&
+               other.bottom() <= bottom();
+    }
+
+    constexpr bool operator==(const Rect &other) const = default;
+};
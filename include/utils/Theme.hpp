@@ -12,6 +12,7 @@
 
 #include "include/drivers/DisplayDriver.hpp" // For fonts
 
+#include <array>
 #include <string_view>
 
 struct Theme {
@@ -24,7 +25,55 @@ struct Theme {
     FontType font;
 };
 
-constexpr Theme DefaultTheme = {
+/// @brief Palette entries of the theme roles, every role has its own entry even when two roles
+/// share a color.
+namespace ThemeSlot {
+    constexpr uint8_t Background = 0;
+    constexpr uint8_t Text = 1;
+    constexpr uint8_t Turret = 2;
+    constexpr uint8_t Shield = 3;
+    constexpr uint8_t Aliens = 4;
+    constexpr uint8_t Selection = 5;
+} // namespace ThemeSlot
+
+/// @brief Ties every color of a theme to the palette entry of its role.
+/// @details The indexed color mode then draws each role with its own entry, so switching the
+/// palette to another theme recolors the screen without a redraw.
+constexpr Theme with_slots(Theme theme) {
+    theme.background = theme.background.in_slot(ThemeSlot::Background);
+    theme.text = theme.text.in_slot(ThemeSlot::Text);
+    theme.turret = theme.turret.in_slot(ThemeSlot::Turret);
+    theme.shield = theme.shield.in_slot(ThemeSlot::Shield);
+    theme.aliens = theme.aliens.in_slot(ThemeSlot::Aliens);
+    theme.selection = theme.selection.in_slot(ThemeSlot::Selection);
+    return theme;
+}
+
+/// @brief Builds the palette for the indexed color mode of the DisplayDriver.
+/// @details The roles come first, each at its ThemeSlot entry and reserved for it. The named
+/// colors follow in entries of their own, so things like a black screen on exit still find an
+/// exact match and keep their color when the theme changes.
+constexpr std::array<Color, 14> theme_palette(const Theme &theme) {
+    const Theme roles = with_slots(theme);
+    return {
+        roles.background,
+        roles.text,
+        roles.turret,
+        roles.shield,
+        roles.aliens,
+        roles.selection,
+        Color::Black,
+        Color::White,
+        Color::Red,
+        Color::Green,
+        Color::Blue,
+        Color::Yellow,
+        Color::Cyan,
+        Color::Magenta,
+    };
+}
+
+constexpr Theme DefaultTheme = with_slots({
     .background = Color::Black,
     .text = Color::White,
     .turret = Color::Green,
@@ -32,9 +81,9 @@ constexpr Theme DefaultTheme = {
     .aliens = Color::White,
     .selection = Color::Green,
     .font = FontType::WinFreeSystem14x16,
-};
+});
 
-constexpr Theme LightTheme = {
+constexpr Theme LightTheme = with_slots({
     .background = Color::White,
     .text = Color::Black,
     .turret = Color::Black,
@@ -42,9 +91,9 @@ constexpr Theme LightTheme = {
     .aliens = Color::Black,
     .selection = Color::Magenta,
     .font = FontType::WinFreeSystem14x16,
-};
+});
 
-constexpr Theme Gruvbox = {
+constexpr Theme Gruvbox = with_slots({
     .background = Color(60, 56, 54), // Dark Grey
     .text = Color::White,
     .turret = Color(215, 153, 33), // Yellowish-Gold
@@ -52,9 +101,9 @@ constexpr Theme Gruvbox = {
     .aliens = Color::Red,
     .selection = Color(215, 153, 33), // Yellowish-Gold
     .font = FontType::WinFreeSystem14x16,
-};
+});
 
-constexpr Theme Solarized = {
+constexpr Theme Solarized = with_slots({
     .background = Color(0, 43, 54),  // Dark Blue
     .text = Color(253, 246, 227),    // Light Cream
     .turret = Color(108, 113, 196),  // Violet
@@ -62,9 +111,9 @@ constexpr Theme Solarized = {
     .aliens = Color(220, 50, 47),    // Red
     .selection = Color(133, 153, 0), // Olive Green
     .font = FontType::ROM8x16,
-};
+});
 
-constexpr Theme Ayu = {
+constexpr Theme Ayu = with_slots({
     .background = Color(39, 44, 51),   // #272c33
     .text = Color(255, 255, 255),      // #ffffff
     .turret = Color(255, 203, 107),    // #ffc36b
@@ -72,9 +121,9 @@ constexpr Theme Ayu = {
     .aliens = Color(255, 135, 162),    // #ff87a2
     .selection = Color(144, 222, 241), // #90def1
     .font = FontType::WinFreeSystem14x16,
-};
+});
 
-constexpr Theme Monokai = {
+constexpr Theme Monokai = with_slots({
     .background = Color(87, 47, 0),   // #572f00
     .text = Color(102, 216, 239),     // #66d9ef
     .turret = Color(253, 151, 31),    // #fd971f (orange)
@@ -82,9 +131,9 @@ constexpr Theme Monokai = {
     .aliens = Color(249, 38, 114),    // #f92672 (pink/red)
     .selection = Color(249, 38, 114), // #f92672
     .font = FontType::ROM8x16,
-};
+});
 
-constexpr Theme HotDogStand = {
+constexpr Theme HotDogStand = with_slots({
     .background = Color::Red,
     .text = Color::Yellow,
     .turret = Color::Black,
@@ -92,7 +141,7 @@ constexpr Theme HotDogStand = {
     .aliens = Color::Black,
     .selection = Color::Black,
     .font = FontType::ROM8x16,
-};
+});
 
 constexpr Theme ThemeList[] = {
     DefaultTheme, 
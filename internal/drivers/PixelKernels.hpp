@@ -0,0 +1,282 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 Matyas Godula
+
+/// @file PixelKernels.hpp
+/// @brief Low level RGB565 kernels shared by the drawing code.
+/// @author Matyas Godula
+/// @date 17.10.2026
+/// @note The NEON paths are picked at compile time when building for the MZ-APO (Cortex-A9 with
+/// -mfpu=neon), host builds use the scalar fallbacks.
+
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace PixelKernels {
+    /// @brief Fills a span of pixels with a single RGB565 value.
+    /// @param dst First pixel of the span.
+    /// @param count Number of pixels to fill.
+    /// @param value The RGB565 value to fill with.
+    inline void fill(uint16_t *dst, int count, uint16_t value) {
+#if defined(__ARM_NEON)
+        // Get to a 16 byte boundary so the 128-bit stores do not straddle cache lines.
+        while (count > 0 && (reinterpret_cast<uintptr_t>(dst) & 15) != 0) {
+            *dst++ = value;
+            --count;
+        }
+        uint16x8_t values = vdupq_n_u16(value);
+        for (; count >= 32; count -= 32, dst += 32) {
+            vst1q_u16(dst, values);
+            vst1q_u16(dst + 8, values);
+            vst1q_u16(dst + 16, values);
+            vst1q_u16(dst + 24, values);
+        }
+        for (; count >= 8; count -= 8, dst += 8) {
+            vst1q_u16(dst, values);
+        }
+#else
+        // Two pixels per store, memcpy keeps the compiler happy about aliasing.
+        if (count > 0 && (reinterpret_cast<uintptr_t>(dst) & 2) != 0) {
+            *dst++ = value;
+            --count;
+        }
+        uint32_t pair = value | (static_cast<uint32_t>(value) << 16);
+        for (; count >= 2; count -= 2, dst += 2) {
+            std::memcpy(dst, &pair, sizeof(pair));
+        }
+#endif
+        while (count > 0) {
+            *dst++ = value;
+            --count;
+        }
+    }
+
+    /// @brief Fills a rectangle of pixels with a single RGB565 value.
+    /// @param dst Top left pixel of the rectangle.
+    /// @param stride Distance between two rows in pixels.
+    /// @param width Width of the rectangle in pixels.
+    /// @param height Height of the rectangle in pixels.
+    /// @param value The RGB565 value to fill with.
+    inline void fill_rect(uint16_t *dst, int stride, int width, int height, uint16_t value) {
+        if (width == stride) { // Contiguous rows are one long span
+            fill(dst, width * height, value);
+            return;
+        }
+        for (int row = 0; row < height; ++row, dst += stride) {
+            fill(dst, width, value);
+        }
+    }
+
+    /// @brief Fills a span of palette indices with a single index.
+    inline void fill(uint8_t *dst, int count, uint8_t value) { std::memset(dst, value, count); }
+
+    /// @brief Fills a rectangle of palette indices with a single index.
+    inline void fill_rect(uint8_t *dst, int stride, int width, int height, uint8_t value) {
+        if (width == stride) { // Contiguous rows are one long span
+            std::memset(dst, value, width * height);
+            return;
+        }
+        for (int row = 0; row < height; ++row, dst += stride) {
+            std::memset(dst, value, width);
+        }
+    }
+
+    /// @brief Expands a span of palette indices into RGB565 pixels.
+    /// @param dst First RGB565 pixel.
+    /// @param src First palette index.
+    /// @param count Number of pixels.
+    /// @param palette The lookup table, 256 entries.
+    inline void expand_indices(
+        uint16_t *dst, const uint8_t *src, int count, const uint16_t *palette
+    ) {
+        for (; count >= 4; count -= 4, dst += 4, src += 4) {
+            dst[0] = palette[src[0]];
+            dst[1] = palette[src[1]];
+            dst[2] = palette[src[2]];
+            dst[3] = palette[src[3]];
+        }
+        for (; count > 0; --count) {
+            *dst++ = palette[*src++];
+        }
+    }
+
+    /// @brief Copies a rectangle of pixels, Pixel is an RGB565 pixel or a palette index.
+    /// @param dst Top left destination pixel.
+    /// @param dst_stride Distance between two destination rows in pixels.
+    /// @param src Top left source pixel.
+    /// @param src_stride Distance between two source rows in pixels.
+    /// @param width Width of the rectangle in pixels.
+    /// @param height Height of the rectangle in pixels.
+    template <typename Pixel>
+    void copy_rect(
+        Pixel *dst, int dst_stride, const Pixel *src, int src_stride, int width, int height
+    ) {
+        if (width == dst_stride && width == src_stride) { // Both contiguous, one big copy
+            std::memcpy(dst, src, width * height * sizeof(Pixel));
+            return;
+        }
+        for (int row = 0; row < height; ++row, dst += dst_stride, src += src_stride) {
+            std::memcpy(dst, src, width * sizeof(Pixel));
+        }
+    }
+
+    /// @brief Copies a rectangle of pixels, skipping pixels equal to a color key. Pixel is an
+    /// RGB565 pixel or a palette index.
+    /// @param dst Top left destination pixel.
+    /// @param dst_stride Distance between two destination rows in pixels.
+    /// @param src Top left source pixel.
+    /// @param src_stride Distance between two source rows in pixels.
+    /// @param width Width of the rectangle in pixels.
+    /// @param height Height of the rectangle in pixels.
+    /// @param key The transparent value.
+    /// @note Runs of opaque pixels are copied with memcpy, so mostly opaque images stay close to
+    /// copy_rect() speed.
+    template <typename Pixel>
+    void copy_rect_keyed(
+        Pixel *dst,
+        int dst_stride,
+        const Pixel *src,
+        int src_stride,
+        int width,
+        int height,
+        Pixel key
+    ) {
+        for (int row = 0; row < height; ++row, dst += dst_stride, src += src_stride) {
+            int x = 0;
+            while (x < width) {
+                while (x < width && src[x] == key) {
+                    ++x;
+                }
+                int run_start = x;
+                while (x < width && src[x] != key) {
+                    ++x;
+                }
+                std::memcpy(dst + run_start, src + run_start, (x - run_start) * sizeof(Pixel));
+            }
+        }
+    }
+
+    /// @brief Converts an 8-bit alpha into the 0-32 weight used by the blend kernels.
+    constexpr uint16_t blend_weight(uint8_t alpha) { return (alpha + 4) >> 3; }
+
+    /// @brief Spreads an RGB565 pixel so that every channel has room for a 5-bit multiply.
+    /// @details Green moves into the upper half (bits 21-26), red (11-15) and blue (0-4) stay,
+    /// each channel gets at least 5 free bits above it.
+    constexpr uint32_t spread(uint16_t pixel) {
+        return (pixel | (static_cast<uint32_t>(pixel) << 16)) & 0x07E0F81Fu;
+    }
+
+    /// @brief Packs a spread pixel back into RGB565.
+    constexpr uint16_t pack(uint32_t spread_pixel) {
+        spread_pixel &= 0x07E0F81Fu;
+        return static_cast<uint16_t>(spread_pixel | (spread_pixel >> 16));
+    }
+
+    /// @brief Blends two pixels, all three channels with one multiply each.
+    /// @param src The pixel drawn on top.
+    /// @param dst The pixel underneath.
+    /// @param weight Weight of src between 0 and 32, see blend_weight().
+    constexpr uint16_t blend(uint16_t src, uint16_t dst, uint16_t weight) {
+        return pack((spread(src) * weight + spread(dst) * (32 - weight)) >> 5);
+    }
+
+#if defined(__ARM_NEON)
+    /// @brief Blends eight pixels whose channels are already multiplied by their weight.
+    inline uint16x8_t blend8(
+        uint16x8_t dst, uint16x8_t src_r, uint16x8_t src_g, uint16x8_t src_b, uint16x8_t inverse
+    ) {
+        uint16x8_t low5 = vdupq_n_u16(0x1F);
+        uint16x8_t low6 = vdupq_n_u16(0x3F);
+        uint16x8_t r = vmlaq_u16(src_r, vshrq_n_u16(dst, 11), inverse);
+        uint16x8_t g = vmlaq_u16(src_g, vandq_u16(vshrq_n_u16(dst, 5), low6), inverse);
+        uint16x8_t b = vmlaq_u16(src_b, vandq_u16(dst, low5), inverse);
+        return vorrq_u16(
+            vshlq_n_u16(vshrq_n_u16(r, 5), 11),
+            vorrq_u16(vshlq_n_u16(vshrq_n_u16(g, 5), 5), vshrq_n_u16(b, 5)));
+    }
+#endif
+
+    /// @brief Blends a single color over a span of pixels.
+    /// @param dst First pixel of the span.
+    /// @param count Number of pixels.
+    /// @param color The RGB565 color drawn on top.
+    /// @param weight Weight of the color between 0 and 32, see blend_weight().
+    inline void blend_fill(uint16_t *dst, int count, uint16_t color, uint16_t weight) {
+#if defined(__ARM_NEON)
+        // Channels are split into lanes of their own, eight pixels per iteration.
+        uint16x8_t inverse = vdupq_n_u16(32 - weight);
+        uint16x8_t src_r = vdupq_n_u16((color >> 11) * weight);
+        uint16x8_t src_g = vdupq_n_u16(((color >> 5) & 0x3F) * weight);
+        uint16x8_t src_b = vdupq_n_u16((color & 0x1F) * weight);
+        for (; count >= 8; count -= 8, dst += 8) {
+            vst1q_u16(dst, blend8(vld1q_u16(dst), src_r, src_g, src_b, inverse));
+        }
+#endif
+        // The color part of the blend is the same for every pixel.
+        uint32_t weighted = spread(color) * weight;
+        uint16_t inverse_weight = 32 - weight;
+        for (; count > 0; --count, ++dst) {
+            *dst = pack((weighted + spread(*dst) * inverse_weight) >> 5);
+        }
+    }
+
+    /// @brief Blends a span of source pixels over a span of destination pixels.
+    /// @param dst First destination pixel.
+    /// @param src First source pixel.
+    /// @param count Number of pixels.
+    /// @param weight Weight of the source between 0 and 32, see blend_weight().
+    inline void blend_copy(uint16_t *dst, const uint16_t *src, int count, uint16_t weight) {
+#if defined(__ARM_NEON)
+        uint16x8_t inverse = vdupq_n_u16(32 - weight);
+        uint16x8_t weights = vdupq_n_u16(weight);
+        uint16x8_t low5 = vdupq_n_u16(0x1F);
+        uint16x8_t low6 = vdupq_n_u16(0x3F);
+        for (; count >= 8; count -= 8, dst += 8, src += 8) {
+            uint16x8_t pixels = vld1q_u16(src);
+            uint16x8_t src_r = vmulq_u16(vshrq_n_u16(pixels, 11), weights);
+            uint16x8_t src_g = vmulq_u16(vandq_u16(vshrq_n_u16(pixels, 5), low6), weights);
+            uint16x8_t src_b = vmulq_u16(vandq_u16(pixels, low5), weights);
+            vst1q_u16(dst, blend8(vld1q_u16(dst), src_r, src_g, src_b, inverse));
+        }
+#endif
+        for (; count > 0; --count, ++dst, ++src) {
+            *dst = blend(*src, *dst, weight);
+        }
+    }
+
+    /// @brief Hashes the pixels of a rectangle, used to find out whether its contents changed.
+    /// @param src Top left pixel of the rectangle, RGB565 pixels or palette indices.
+    /// @param stride Distance between two rows in pixels.
+    /// @param width Width of the rectangle in pixels.
+    /// @param height Height of the rectangle in pixels.
+    /// @return 32-bit hash of the pixels, the MurmurHash3 block mix over 4 byte blocks.
+    template <typename Pixel>
+    uint32_t hash_rect(const Pixel *src, int stride, int width, int height) {
+        uint32_t hash = 0;
+        auto mix = [&hash](uint32_t block) {
+            block *= 0xCC9E2D51u;
+            block = std::rotl(block, 15) * 0x1B873593u;
+            hash = std::rotl(hash ^ block, 13) * 5 + 0xE6546B64u;
+        };
+        int row_bytes = width * static_cast<int>(sizeof(Pixel));
+        for (int row = 0; row < height; ++row, src += stride) {
+            const auto *bytes = reinterpret_cast<const uint8_t *>(src);
+            int offset = 0;
+            for (; offset + 4 <= row_bytes; offset += 4) {
+                uint32_t block;
+                std::memcpy(&block, bytes + offset, sizeof(block));
+                mix(block);
+            }
+            for (; offset < row_bytes; ++offset) {
+                mix(bytes[offset]);
+            }
+        }
+        return hash;
+    }
+} // namespace PixelKernels
@@ -56,6 +56,8 @@ class TutorialModule : public Module {
         /// @brief Tracks whether the the tutorial has been shown.
         bool tutorial_shown = false;
         int text_position = 0;
+        /// @brief How far the text moved since the last redraw.
+        int scrolled_lines = 0;
         DisplayDriver *const screen;
         AudioDriver *const buzzer;
         SpiledDriver *const spiled;
@@ -13,9 +13,10 @@
 #include <stop_token>
 #include <thread>
 
-AudioDriver::AudioDriver() : stop_source() {
-    pwm_reg = static_cast<void *>(map_phys_address(AUDIOPWM_REG_BASE_PHYS, AUDIOPWM_REG_SIZE, 0));
+AudioDriver::AudioDriver()
+    : AudioDriver(map_phys_address(AUDIOPWM_REG_BASE_PHYS, AUDIOPWM_REG_SIZE, 0)) {}
 
+AudioDriver::AudioDriver(void *pwm_reg) : pwm_reg(pwm_reg), stop_source() {
     if (pwm_reg == nullptr) {
         throw std::runtime_error("Failed to map physical address");
     }
@@ -1,65 +1,572 @@
 #include "include/drivers/DisplayDriver.hpp"
 
-#include "assets/fonts/font_types.h"
+#include "internal/drivers/PixelKernels.hpp"
 
-#include "third_party/mzapo/mzapo_parlcd.h"
-#include "third_party/mzapo/mzapo_phys.h"
-#include "third_party/mzapo/mzapo_regs.h"
+#include "assets/fonts/font_types.h"
 
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
 #include <iostream>
+#include <mutex>
 #include <stdexcept>
+#include <stop_token>
 #include <string_view>
+#include <sys/mman.h>
+#include <thread>
 #include <utility>
 
-DisplayDriver::DisplayDriver(DisplayOrientation orientation) : orientation(orientation) {
+namespace {
+    /// @brief Writes the set bits of a glyph, Pixel is an RGB565 pixel or a palette index.
+    template <typename Pixel>
+    void put_glyph_rows(
+        Pixel *first_row,
+        int stride,
+        const Rect &visible,
+        int x,
+        int y,
+        const font_bits_t *glyph_bits,
+        Pixel value
+    ) {
+        Pixel *row = first_row;
+        for (int screen_y = visible.y; screen_y < visible.bottom(); ++screen_y, row += stride) {
+            uint16_t row_data = glyph_bits[screen_y - y];
+            for (int screen_x = visible.x; screen_x < visible.right(); ++screen_x) {
+                if (row_data & (0x8000 >> (screen_x - x))) {
+                    row[screen_x] = value;
+                }
+            }
+        }
+    }
+
+    /// @brief Writes the set pixels of a sprite, Pixel is an RGB565 pixel or a palette index.
+    template <typename Pixel>
+    void put_sprite_rows(
+        Pixel *first_row, int stride, const Rect &visible, int x, int y, const Sprite &sprite,
+        Pixel value
+    ) {
+        // Row by row so consecutive writes land next to each other in the target.
+        Pixel *row = first_row;
+        for (int screen_y = visible.y; screen_y < visible.bottom(); ++screen_y, row += stride) {
+            for (int screen_x = visible.x; screen_x < visible.right(); ++screen_x) {
+                if (sprite.at(screen_x - x, screen_y - y) != 0) {
+                    row[screen_x] = value;
+                }
+            }
+        }
+    }
+
+    /// @brief Rotates the rows top to bottom of a buffer, row top + k receives row top + k + shift.
+    /// @param shift Rows to move up by, between 0 and bottom - top.
+    template <typename Pixel>
+    void rotate_rows(Pixel *buffer, int stride, int top, int bottom, int shift) {
+        Pixel *first = buffer + top * stride;
+        std::rotate(first, first + shift * stride, buffer + bottom * stride);
+    }
 
-    lcd = map_phys_address(PARLCD_REG_BASE_PHYS, PARLCD_REG_SIZE, 0);
-    if (lcd == nullptr) {
-        throw std::runtime_error("Failed to map physical address");
+    /// @brief Copies count rows of a column range from row from to row to of the same buffer.
+    template <typename Pixel>
+    void move_rows(Pixel *buffer, int stride, int x, int width, int from, int to, int count) {
+        if (width == stride) { // Whole rows are one block
+            std::memmove(buffer + to * stride, buffer + from * stride,
+                         count * stride * sizeof(Pixel));
+            return;
+        }
+        // Copy away from the direction of the move, so no row is overwritten before it is read.
+        int step = to > from ? -1 : 1;
+        int first = to > from ? count - 1 : 0;
+        for (int i = first; i >= 0 && i < count; i += step) {
+            std::memcpy(buffer + (to + i) * stride + x, buffer + (from + i) * stride + x,
+                        width * sizeof(Pixel));
+        }
     }
 
-    parlcd_hx8357_init(static_cast<uint8_t *>(lcd));
+    /// @brief Writes clipped spans of one value into a render target, Pixel is an RGB565 pixel or
+    /// a palette index. The rasterizers below only produce spans, clipping happens here.
+    template <typename Pixel>
+    struct Spans {
+        Pixel *pixels;
+        int stride;
+        int origin_y;
+        Rect clip;
+        Pixel value;
+
+        /// @brief Fills width pixels of row y starting at x.
+        void row(int x, int y, int width) const {
+            if (y < clip.y || y >= clip.bottom()) {
+                return;
+            }
+            int left = std::max(x, clip.x);
+            int right = std::min(x + width, clip.right());
+            if (left < right) {
+                PixelKernels::fill(pixels + (y - origin_y) * stride + left, right - left, value);
+            }
+        }
+
+        /// @brief Fills height pixels of column x starting at y.
+        void column(int x, int y, int height) const {
+            if (x < clip.x || x >= clip.right()) {
+                return;
+            }
+            int top = std::max(y, clip.y);
+            int bottom = std::min(y + height, clip.bottom());
+            Pixel *pixel = pixels + (top - origin_y) * stride + x;
+            for (int row_y = top; row_y < bottom; ++row_y, pixel += stride) {
+                *pixel = value;
+            }
+        }
+    };
+
+    /// @brief Rounds a division towards negative infinity, the divisor has to be positive.
+    int64_t floor_div(int64_t numerator, int64_t divisor) {
+        int64_t quotient = numerator / divisor;
+        return (numerator % divisor < 0) ? quotient - 1 : quotient;
+    }
+
+    /// @brief Bresenham line, pixels sharing a row (a column for steep lines) form one span.
+    template <typename Pixel>
+    void line_spans(const Spans<Pixel> &spans, int x0, int y0, int x1, int y1) {
+        if (y0 == y1) {
+            spans.row(std::min(x0, x1), y0, std::abs(x1 - x0) + 1);
+            return;
+        }
+        if (x0 == x1) {
+            spans.column(x0, std::min(y0, y1), std::abs(y1 - y0) + 1);
+            return;
+        }
+
+        // Walk the major axis u one pixel per step, the minor axis v follows.
+        bool steep = std::abs(y1 - y0) > std::abs(x1 - x0);
+        int u0 = steep ? y0 : x0;
+        int v0 = steep ? x0 : y0;
+        int du = std::abs(steep ? y1 - y0 : x1 - x0);
+        int dv = std::abs(steep ? x1 - x0 : y1 - y0);
+        int su = (steep ? y1 > y0 : x1 > x0) ? 1 : -1;
+        int sv = (steep ? x1 > x0 : y1 > y0) ? 1 : -1;
+
+        // Steps outside of the clip along the major axis are skipped, not walked.
+        int u_min = steep ? spans.clip.y : spans.clip.x;
+        int u_max = (steep ? spans.clip.bottom() : spans.clip.right()) - 1;
+        int first = std::max(su > 0 ? u_min - u0 : u0 - u_max, 0);
+        int last = std::min(su > 0 ? u_max - u0 : u0 - u_min, du);
+        if (first > last) {
+            return;
+        }
+
+        // Step i lands on v0 + sv * (2 * i * dv + du) / (2 * du), the error is the remainder of
+        // that division, so the walk can start at any step and still hit the same pixels.
+        int64_t numerator = 2 * static_cast<int64_t>(first) * dv + du;
+        int v = v0 + sv * static_cast<int>(numerator / (2 * du));
+        int error = static_cast<int>(numerator % (2 * du));
+        int run_start = first;
+        for (int i = first; i <= last; ++i) {
+            error += 2 * dv;
+            bool next = error >= 2 * du;
+            if (next || i == last) {
+                int start = (su > 0) ? u0 + run_start : u0 - i;
+                if (steep) {
+                    spans.column(v, start, i - run_start + 1);
+                } else {
+                    spans.row(start, v, i - run_start + 1);
+                }
+                run_start = i + 1;
+            }
+            if (next) {
+                error -= 2 * du;
+                v += sv;
+            }
+        }
+    }
+
+    /// @brief Midpoint circle, one octant is walked and mirrored into the other seven.
+    template <typename Pixel>
+    void circle_spans(const Spans<Pixel> &spans, int cx, int cy, int radius, bool filled) {
+        int x = 0;
+        int y = radius;
+        int error = 1 - radius;
+        int run_start = 0;
+        while (x <= y) {
+            int next_y = y;
+            if (error < 0) {
+                error += 2 * x + 3;
+            } else {
+                error += 2 * (x - y) + 5;
+                --next_y;
+            }
+
+            if (filled) {
+                // Rows cy +- x are reached once each, rows cy +- y are done when y moves on.
+                spans.row(cx - y, cy + x, 2 * y + 1);
+                if (x != 0) {
+                    spans.row(cx - y, cy - x, 2 * y + 1);
+                }
+                if (next_y != y) {
+                    spans.row(cx - x, cy + y, 2 * x + 1);
+                    spans.row(cx - x, cy - y, 2 * x + 1);
+                }
+            } else if (next_y != y || x + 1 > next_y) {
+                // The run of x at distance y is a span in four rows and four columns.
+                int length = x - run_start + 1;
+                spans.row(cx + run_start, cy + y, length);
+                spans.row(cx - x, cy + y, length);
+                spans.row(cx + run_start, cy - y, length);
+                spans.row(cx - x, cy - y, length);
+                spans.column(cx + y, cy + run_start, length);
+                spans.column(cx + y, cy - x, length);
+                spans.column(cx - y, cy + run_start, length);
+                spans.column(cx - y, cy - x, length);
+                run_start = x + 1;
+            }
+            ++x;
+            y = next_y;
+        }
+    }
+
+    /// @brief Polygon edge walked one row at a time, its x is kept as an exact fraction.
+    struct PolygonEdge {
+        int top;       ///< First row crossing the edge.
+        int bottom;    ///< One past the last row crossing the edge.
+        int x;         ///< Whole part of the crossing in the current row.
+        int remainder; ///< Fractional part of the crossing, in units of 1 / height.
+        int step;      ///< Whole part of the x change per row.
+        int step_remainder;
+        int height;
+    };
+
+    /// @brief Scanline polygon fill with the even-odd rule.
+    template <typename Pixel>
+    void polygon_spans(const Spans<Pixel> &spans, std::span<const Point> points) {
+        PolygonEdge edges[DisplayConstants::Polygon::MaxPoints];
+        int edge_count = 0;
+        int top = INT_MAX;
+        int bottom = INT_MIN;
+        for (size_t i = 0; i < points.size(); ++i) {
+            Point a = points[i];
+            Point b = points[(i + 1) % points.size()];
+            if (a.y == b.y) { // Horizontal edges never cross a row
+                continue;
+            }
+            if (a.y > b.y) {
+                std::swap(a, b);
+            }
+            int width = b.x - a.x;
+            int height = b.y - a.y;
+            int64_t step = floor_div(width, height);
+            edges[edge_count++] = PolygonEdge{
+                .top = a.y,
+                .bottom = b.y,
+                .x = a.x,
+                .remainder = 0,
+                .step = static_cast<int>(step),
+                .step_remainder = static_cast<int>(width - step * height),
+                .height = height,
+            };
+            top = std::min(top, a.y);
+            bottom = std::max(bottom, b.y);
+        }
+
+        int first_row = std::max(top, spans.clip.y);
+        int end_row = std::min(bottom, spans.clip.bottom());
+        // Edges starting above the clip jump straight to the first visible row.
+        for (int i = 0; i < edge_count; ++i) {
+            PolygonEdge &edge = edges[i];
+            if (edge.top < first_row) {
+                int64_t width =
+                    static_cast<int64_t>(edge.step) * edge.height + edge.step_remainder;
+                int64_t offset = (first_row - edge.top) * width;
+                int64_t whole = floor_div(offset, edge.height);
+                edge.x += static_cast<int>(whole);
+                edge.remainder = static_cast<int>(offset - whole * edge.height);
+            }
+        }
+
+        int crossings[DisplayConstants::Polygon::MaxPoints];
+        for (int y = first_row; y < end_row; ++y) {
+            int count = 0;
+            for (int i = 0; i < edge_count; ++i) {
+                PolygonEdge &edge = edges[i];
+                if (y < edge.top || y >= edge.bottom) {
+                    continue;
+                }
+                // The first pixel whose top left corner is right of the crossing.
+                int x = edge.x + (edge.remainder > 0);
+                int slot = count++;
+                for (; slot > 0 && crossings[slot - 1] > x; --slot) { // Insertion sort
+                    crossings[slot] = crossings[slot - 1];
+                }
+                crossings[slot] = x;
+
+                edge.x += edge.step;
+                edge.remainder += edge.step_remainder;
+                if (edge.remainder >= edge.height) {
+                    edge.remainder -= edge.height;
+                    ++edge.x;
+                }
+            }
+            for (int i = 0; i + 1 < count; i += 2) {
+                spans.row(crossings[i], y, crossings[i + 1] - crossings[i]);
+            }
+        }
+    }
+} // namespace
+
+DisplayDriver::PixelBuffers DisplayDriver::static_buffers;
+std::atomic<bool> DisplayDriver::static_buffers_taken = false;
+
+DisplayDriver::BufferOwner::BufferOwner(BufferStorage storage) : storage(storage) {
+    switch (storage) {
+    case BufferStorage::Static:
+        if (static_buffers_taken.exchange(true)) {
+            throw std::runtime_error("Static display buffers are already in use");
+        }
+        buffers = &static_buffers;
+        // Clears what the previous driver left and faults the pages in before the first frame.
+        std::memset(buffers, 0, sizeof(PixelBuffers));
+        break;
+    case BufferStorage::Heap:
+        buffers = new PixelBuffers{}; // Zeroing touches every page now instead of mid frame
+        break;
+    case BufferStorage::Locked: {
+        void *memory = mmap(nullptr, sizeof(PixelBuffers), PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+        if (memory == MAP_FAILED) {
+            throw std::runtime_error("Failed to map the display buffers");
+        }
+        // Fails without root or a big enough RLIMIT_MEMLOCK, the pages are still populated then.
+        mlock(memory, sizeof(PixelBuffers));
+        buffers = static_cast<PixelBuffers *>(memory);
+        break;
+    }
+    }
 }
 
-DisplayDriver::~DisplayDriver() {
-    std::cout << "DisplayDriver ending!..." << std::endl;
+DisplayDriver::BufferOwner::~BufferOwner() {
+    switch (storage) {
+    case BufferStorage::Static:
+        static_buffers_taken = false;
+        break;
+    case BufferStorage::Heap:
+        delete buffers;
+        break;
+    case BufferStorage::Locked:
+        munmap(buffers, sizeof(PixelBuffers)); // Also unlocks the pages
+        break;
+    }
 }
 
-inline std::pair<int, int> DisplayDriver::map_coords(int x, int y) {
-    switch (orientation) {
-    case DisplayOrientation::Landscape:
-        return {x, y};
+DisplayDriver::DisplayDriver(DisplayOrientation orientation, BufferStorage storage)
+    : buffers(storage), orientation(orientation) {
+
+    backend.reset();
+    apply_orientation();
+
+    // Nothing is known about the panel contents yet, the first flush has to send everything.
+    damage.add(Rect{0, 0, screen_width, screen_height});
 
-    case DisplayOrientation::Portrait:
-        return {y, screen_height - 1 - x};
+    // Same pattern as the AudioDriver, the worker gets our own stop token.
+    worker = std::jthread(
+        [this](std::stop_token token) { flush_thread_loop(token); }, stop_source.get_token());
+}
+
+DisplayDriver::~DisplayDriver() {
+    // The last frame (usually a black screen) has to reach the display before we stop.
+    wait_for_flush();
+    {
+        // Under the mutex, so the worker can not test its wait predicate before the stop and
+        // block after the notification below.
+        std::lock_guard lock(flush_mutex);
+        stop_source.request_stop();
+    }
+    flush_condvar.notify_one();
+    std::cout << "DisplayDriver ending!..." << std::endl;
+}
 
-    default:
-        return {x, y};
+void DisplayDriver::mark_damage(Rect rect) {
+    const RenderTarget &dst = current_target();
+    if (dst.damage == nullptr) {
+        return;
+    }
+    rect = dst.clip.intersect(rect);
+    dst.damage->add(rect);
+    if (dst.clears != nullptr) {
+        dst.clears->drawn.add(rect);
     }
 }
 
 void DisplayDriver::draw_pixel(int x, int y, Color color) {
+    if (record(DrawCommand{
+            .kind = DrawCommand::Kind::Pixel, .color = color, .area = Rect{x, y, 1, 1}})) {
+        return;
+    }
     if (in_bounds(x, y)) {
-        auto [mapped_x, mapped_y] = map_coords(x, y);
-        fb[mapped_y * screen_width + mapped_x] = color.to_rgb565();
+        const RenderTarget &dst = current_target();
+        if (dst.indices != nullptr) {
+            dst.index_row(y)[x] = palette_index(color);
+        } else {
+            dst.row(y)[x] = color.to_rgb565();
+        }
+        mark_damage(Rect{x, y, 1, 1});
     }
 }
 
 void DisplayDriver::draw_pixel(int x, int y, uint16_t color) {
-    if (in_bounds(x, y)) {
-        auto [mapped_x, mapped_y] = map_coords(x, y);
-        fb[mapped_y * screen_width + mapped_x] = color;
-    }
+    draw_pixel(x, y, Color::from_rgb565(color));
 }
 
 void DisplayDriver::draw_rectangle(int x, int y, int width, int height, Color color) {
-    for (int i = 0; i < width; ++i) {
-        for (int j = 0; j < height; ++j) {
-            if (in_bounds(x + i, y + j)) {
-                draw_pixel(x + i, y + j, color);
-            }
-        }
+    if (record(DrawCommand{.kind = DrawCommand::Kind::Rectangle,
+                           .color = color,
+                           .area = Rect{x, y, width, height}})) {
+        return;
+    }
+
+    const RenderTarget &dst = current_target();
+    Rect visible = Rect{x, y, width, height}.intersect(dst.clip);
+    if (visible.empty()) {
+        return;
+    }
+
+    // Every row of the rectangle is one contiguous span of the target.
+    if (dst.indices != nullptr) {
+        PixelKernels::fill_rect(
+            dst.index_row(visible.y) + visible.x,
+            dst.stride,
+            visible.width,
+            visible.height,
+            palette_index(color));
+    } else {
+        PixelKernels::fill_rect(
+            dst.row(visible.y) + visible.x,
+            dst.stride,
+            visible.width,
+            visible.height,
+            color.to_rgb565());
+    }
+    mark_damage(visible);
+}
+
+void DisplayDriver::draw_line(int x0, int y0, int x1, int y1, Color color) {
+    Rect area{std::min(x0, x1), std::min(y0, y1), std::abs(x1 - x0) + 1, std::abs(y1 - y0) + 1};
+    const Point ends[] = {{x0, y0}, {x1, y1}};
+    if (record(DrawCommand{.kind = DrawCommand::Kind::Line,
+                           .color = color,
+                           .area = area},
+               {},
+               ends)) {
+        return;
+    }
+
+    const RenderTarget &dst = current_target();
+    if (area.intersect(dst.clip).empty()) {
+        return;
+    }
+    if (dst.indices != nullptr) {
+        uint8_t value = palette_index(color);
+        line_spans(Spans<uint8_t>{dst.indices, dst.stride, dst.origin_y, dst.clip, value},
+                   x0, y0, x1, y1);
+    } else {
+        line_spans(
+            Spans<uint16_t>{dst.pixels, dst.stride, dst.origin_y, dst.clip, color.to_rgb565()},
+            x0, y0, x1, y1);
+    }
+    // The bounding box, one rectangle per line keeps the damage list from overflowing.
+    mark_damage(area);
+}
+
+void DisplayDriver::draw_circle(int center_x, int center_y, int radius, Color color) {
+    draw_circle_shape(center_x, center_y, radius, color, false);
+}
+
+void DisplayDriver::fill_circle(int center_x, int center_y, int radius, Color color) {
+    draw_circle_shape(center_x, center_y, radius, color, true);
+}
+
+void DisplayDriver::draw_circle_shape(int cx, int cy, int radius, Color color, bool filled) {
+    Rect area{cx - radius, cy - radius, 2 * radius + 1, 2 * radius + 1};
+    if (record(DrawCommand{.kind = filled ? DrawCommand::Kind::FilledCircle
+                                          : DrawCommand::Kind::Circle,
+                           .color = color,
+                           .area = area})) {
+        return;
+    }
+
+    const RenderTarget &dst = current_target();
+    if (radius < 0 || area.intersect(dst.clip).empty()) {
+        return;
+    }
+    if (dst.indices != nullptr) {
+        uint8_t value = palette_index(color);
+        circle_spans(Spans<uint8_t>{dst.indices, dst.stride, dst.origin_y, dst.clip, value},
+                     cx, cy, radius, filled);
+    } else {
+        circle_spans(
+            Spans<uint16_t>{dst.pixels, dst.stride, dst.origin_y, dst.clip, color.to_rgb565()},
+            cx, cy, radius, filled);
+    }
+    mark_damage(area);
+}
+
+void DisplayDriver::fill_polygon(std::span<const Point> points, Color color) {
+    if (points.size() > DisplayConstants::Polygon::MaxPoints) {
+        std::cout << "Too many polygon points\n";
+        return;
+    }
+    Rect area{};
+    if (!points.empty()) {
+        auto [min_x, max_x] = std::ranges::minmax(points, {}, &Point::x);
+        auto [min_y, max_y] = std::ranges::minmax(points, {}, &Point::y);
+        // Pixels are filled by their top left corner, the last column and row are outside.
+        area = Rect{min_x.x, min_y.y, max_x.x - min_x.x, max_y.y - min_y.y};
+    }
+    if (record(DrawCommand{.kind = DrawCommand::Kind::Polygon,
+                           .color = color,
+                           .area = area},
+               {},
+               points)) {
+        return;
+    }
+
+    const RenderTarget &dst = current_target();
+    if (area.intersect(dst.clip).empty()) {
+        return;
+    }
+    if (dst.indices != nullptr) {
+        uint8_t value = palette_index(color);
+        polygon_spans(Spans<uint8_t>{dst.indices, dst.stride, dst.origin_y, dst.clip, value},
+                      points);
+    } else {
+        polygon_spans(
+            Spans<uint16_t>{dst.pixels, dst.stride, dst.origin_y, dst.clip, color.to_rgb565()},
+            points);
+    }
+    mark_damage(area);
+}
+
+int DisplayDriver::put_glyph(
+    int x, int y, const font_descriptor_t *fdes, int glyph_index, Color color
+) {
+    const font_bits_t *glyph_bits = fdes->bits + glyph_index * fdes->height;
+
+    int glyph_width = (fdes->width) ? fdes->width[glyph_index] : fdes->maxwidth;
+    uint16_t value = color.to_rgb565();
+
+    // Clip once, the loops below never have to check the target bounds.
+    const RenderTarget &dst = current_target();
+    Rect visible = Rect{x, y, glyph_width, static_cast<int>(fdes->height)}.intersect(dst.clip);
+    if (visible.empty()) {
+        return glyph_width;
+    }
+
+    if (dst.indices != nullptr) {
+        put_glyph_rows(dst.index_row(visible.y), dst.stride, visible, x, y, glyph_bits,
+                       palette_index(color));
+    } else {
+        put_glyph_rows(dst.row(visible.y), dst.stride, visible, x, y, glyph_bits, value);
     }
+    return glyph_width;
 }
 
 void DisplayDriver::draw_letter(int x, int y, FontType font, char ch, Color color) {
@@ -73,18 +580,17 @@ void DisplayDriver::draw_letter(int x, int y, FontType font, char ch, Color colo
         std::cout << "Invalid index\n";
         return;
     }
-    const font_bits_t *glyph_bits = fdes->bits + glyph_index * fdes->height;
-
     int glyph_width = (fdes->width) ? fdes->width[glyph_index] : fdes->maxwidth;
-
-    for (int row = 0; row < fdes->height; ++row) {
-        uint16_t row_data = glyph_bits[row];
-        for (int col = 0; col < glyph_width; ++col) {
-            if (row_data & (1 << (15 - col))) {
-                draw_pixel(x + col, y + row, color);
-            }
-        }
+    if (record(
+            DrawCommand{.kind = DrawCommand::Kind::Letter,
+                        .font = static_cast<uint8_t>(font),
+                        .color = color,
+                        .area = Rect{x, y, glyph_width, static_cast<int>(fdes->height)}},
+            std::string_view(&ch, 1))) {
+        return;
     }
+    put_glyph(x, y, fdes, glyph_index, color);
+    mark_damage(Rect{x, y, glyph_width, static_cast<int>(fdes->height)});
 }
 
 void DisplayDriver::draw_text(int x, int y, FontType font, std::string_view text, Color color) {
@@ -92,8 +598,17 @@ void DisplayDriver::draw_text(int x, int y, FontType font, std::string_view text
     if (fdes == nullptr) { // Invalid font type
         return;
     }
+    if (record(
+            DrawCommand{.kind = DrawCommand::Kind::Text,
+                        .font = static_cast<uint8_t>(font),
+                        .color = color,
+                        .area = measure_text(x, y, fdes, text)},
+            text)) {
+        return;
+    }
 
     int start_x = x;
+    Rect text_bounds{};
 
     for (char letter : text) {
         if (letter == '\n') {
@@ -106,62 +621,1258 @@ void DisplayDriver::draw_text(int x, int y, FontType font, std::string_view text
             letter = fdes->defaultchar; // Replace invalid characters with the default character
         }
 
-        draw_letter(x, y, font, letter, color);
+        int char_width = put_glyph(x, y, fdes, letter - fdes->firstchar, color);
+        text_bounds = text_bounds.unite(Rect{x, y, char_width, static_cast<int>(fdes->height)});
 
-        int char_width = (fdes->width) ? fdes->width[letter - fdes->firstchar] : fdes->maxwidth;
         x += char_width + DisplayConstants::Text::HorizontalSpacing; // Move to the next character
                                                                      // position + spacing
     }
+    // One rectangle for the whole text, marking every glyph would only fill up the damage list.
+    mark_damage(text_bounds);
 }
 
 void DisplayDriver::draw_sprite(int x, int y, const Sprite &sprite, Color color) {
-    for (int i = 0; i < sprite.width; ++i) {
-        for (int j = 0; j < sprite.height; ++j) {
-            uint8_t pixel = sprite.at(i, j);
-            if (pixel != 0 && in_bounds(x + i, y + j)) {
-                draw_pixel(x + i, y + j, color);
+    if (record(DrawCommand{.kind = DrawCommand::Kind::Sprite,
+                           .color = color,
+                           .area = Rect{x, y, sprite.width, sprite.height},
+                           .sprite = &sprite})) {
+        return;
+    }
+
+    uint16_t value = color.to_rgb565();
+    const RenderTarget &dst = current_target();
+    Rect visible = Rect{x, y, sprite.width, sprite.height}.intersect(dst.clip);
+    if (visible.empty()) {
+        return;
+    }
+
+    if (dst.indices != nullptr) {
+        put_sprite_rows(dst.index_row(visible.y), dst.stride, visible, x, y, sprite,
+                        palette_index(color));
+    } else {
+        put_sprite_rows(dst.row(visible.y), dst.stride, visible, x, y, sprite, value);
+    }
+    mark_damage(visible);
+}
+
+void DisplayDriver::draw_image(int x, int y, const Image &image) {
+    if (record(DrawCommand{.kind = DrawCommand::Kind::Image,
+                           .area = Rect{x, y, image.width, image.height},
+                           .image = image})) {
+        return;
+    }
+
+    const RenderTarget &dst = current_target();
+    Rect visible = Rect{x, y, image.width, image.height}.intersect(dst.clip);
+    if (visible.empty()) {
+        return;
+    }
+    const uint16_t *src = image.row(visible.y - y) + (visible.x - x);
+    if (dst.indices != nullptr) {
+        quantize_rect(dst.index_row(visible.y) + visible.x, dst.stride, src, image.stride,
+                      visible.width, visible.height, false, 0);
+    } else {
+        PixelKernels::copy_rect(dst.row(visible.y) + visible.x, dst.stride, src, image.stride,
+                                visible.width, visible.height);
+    }
+    mark_damage(visible);
+}
+
+void DisplayDriver::draw_image(int x, int y, const Image &image, Color color_key) {
+    if (record(DrawCommand{.kind = DrawCommand::Kind::KeyedImage,
+                           .color = color_key,
+                           .area = Rect{x, y, image.width, image.height},
+                           .image = image})) {
+        return;
+    }
+
+    const RenderTarget &dst = current_target();
+    Rect visible = Rect{x, y, image.width, image.height}.intersect(dst.clip);
+    if (visible.empty()) {
+        return;
+    }
+    const uint16_t *src = image.row(visible.y - y) + (visible.x - x);
+    if (dst.indices != nullptr) {
+        quantize_rect(dst.index_row(visible.y) + visible.x, dst.stride, src, image.stride,
+                      visible.width, visible.height, true, color_key.to_rgb565());
+    } else {
+        PixelKernels::copy_rect_keyed(dst.row(visible.y) + visible.x, dst.stride, src,
+                                      image.stride, visible.width, visible.height,
+                                      color_key.to_rgb565());
+    }
+    mark_damage(visible);
+}
+
+void DisplayDriver::draw_surface(int x, int y, const Surface &surface) {
+    if (record(DrawCommand{.kind = DrawCommand::Kind::Surface,
+                           .area = Rect{x, y, surface.width, surface.height},
+                           .surface = &surface})) {
+        return;
+    }
+    put_surface(x, y, surface, false, 0);
+}
+
+void DisplayDriver::draw_surface(int x, int y, const Surface &surface, Color color_key) {
+    if (record(DrawCommand{.kind = DrawCommand::Kind::KeyedSurface,
+                           .color = color_key,
+                           .area = Rect{x, y, surface.width, surface.height},
+                           .surface = &surface})) {
+        return;
+    }
+    put_surface(x, y, surface, true, color_key.to_rgb565());
+}
+
+void DisplayDriver::put_surface(int x, int y, const Surface &surface, bool keyed, uint16_t key) {
+    const RenderTarget &dst = current_target();
+    Rect visible = Rect{x, y, surface.width, surface.height}.intersect(dst.clip);
+    if (visible.empty()) {
+        return;
+    }
+    int src_x = visible.x - x;
+    int src_y = visible.y - y;
+
+    if (surface.mode == ColorMode::Rgb565) {
+        const uint16_t *src = surface.row(src_y) + src_x;
+        if (dst.indices != nullptr) {
+            quantize_rect(dst.index_row(visible.y) + visible.x, dst.stride, src, surface.width,
+                          visible.width, visible.height, keyed, key);
+            mark_damage(visible);
+            return;
+        }
+        uint16_t *out = dst.row(visible.y) + visible.x;
+        if (keyed) {
+            PixelKernels::copy_rect_keyed(
+                out, dst.stride, src, surface.width, visible.width, visible.height, key);
+        } else {
+            PixelKernels::copy_rect(
+                out, dst.stride, src, surface.width, visible.width, visible.height);
+        }
+        mark_damage(visible);
+        return;
+    }
+
+    const uint8_t *src = surface.index_row(src_y) + src_x;
+    uint8_t key_index = palette_index(key);
+    if (dst.indices != nullptr) {
+        uint8_t *out = dst.index_row(visible.y) + visible.x;
+        if (keyed) {
+            PixelKernels::copy_rect_keyed(
+                out, dst.stride, src, surface.width, visible.width, visible.height, key_index);
+        } else {
+            PixelKernels::copy_rect(
+                out, dst.stride, src, surface.width, visible.width, visible.height);
+        }
+    } else {
+        // A true color target gets the indices expanded through the palette.
+        for (int row = 0; row < visible.height; ++row, src += surface.width) {
+            uint16_t *out = dst.row(visible.y + row) + visible.x;
+            if (!keyed) {
+                PixelKernels::expand_indices(out, src, visible.width, palette);
+                continue;
+            }
+            for (int i = 0; i < visible.width; ++i) {
+                if (src[i] != key_index) {
+                    out[i] = palette[src[i]];
+                }
             }
         }
     }
+    mark_damage(visible);
+}
+
+void DisplayDriver::draw_to(Surface &surface, const std::function<void()> &draw) {
+    RenderTarget saved = target;
+    target = RenderTarget{surface.pixels.get(), surface.width, 0,
+                          Rect{0, 0, surface.width, surface.height}, nullptr,
+                          surface.indices.get()};
+
+    // Nothing is recorded or flushed, the render callbacks already run in this state.
+    bool was_in_callback = in_render_callback;
+    if (!was_in_callback) {
+        in_render_callback = true;
+    }
+    draw();
+    if (!was_in_callback) {
+        in_render_callback = false;
+    }
+    target = saved;
+    ++surface.version;
+}
+
+void DisplayDriver::blend_rectangle(
+    int x, int y, int width, int height, Color color, uint8_t alpha
+) {
+    if (record(DrawCommand{.kind = DrawCommand::Kind::BlendRectangle,
+                           .alpha = alpha,
+                           .color = color,
+                           .area = Rect{x, y, width, height}})) {
+        return;
+    }
+
+    const RenderTarget &dst = current_target();
+    Rect visible = Rect{x, y, width, height}.intersect(dst.clip);
+    if (visible.empty()) {
+        return;
+    }
+    uint16_t weight = PixelKernels::blend_weight(alpha);
+    if (dst.indices != nullptr) {
+        // The blend only depends on the index underneath, so it is worked out once per entry.
+        uint8_t lut[DisplayConstants::Palette::Size];
+        blend_lut(lut, color.to_rgb565(), weight);
+        for (int screen_y = visible.y; screen_y < visible.bottom(); ++screen_y) {
+            uint8_t *out = dst.index_row(screen_y) + visible.x;
+            for (int i = 0; i < visible.width; ++i) {
+                out[i] = lut[out[i]];
+            }
+        }
+    } else {
+        for (int screen_y = visible.y; screen_y < visible.bottom(); ++screen_y) {
+            PixelKernels::blend_fill(
+                dst.row(screen_y) + visible.x, visible.width, color.to_rgb565(), weight);
+        }
+    }
+    mark_damage(visible);
+}
+
+void DisplayDriver::blend_image(int x, int y, const Image &image, uint8_t alpha) {
+    if (record(DrawCommand{.kind = DrawCommand::Kind::BlendImage,
+                           .alpha = alpha,
+                           .area = Rect{x, y, image.width, image.height},
+                           .image = image})) {
+        return;
+    }
+
+    const RenderTarget &dst = current_target();
+    Rect visible = Rect{x, y, image.width, image.height}.intersect(dst.clip);
+    if (visible.empty()) {
+        return;
+    }
+    uint16_t weight = PixelKernels::blend_weight(alpha);
+    if (dst.indices != nullptr) {
+        // Blended through the palette colors, neighbouring pixels mostly repeat the last lookup.
+        auto lookup = [this, weight](uint16_t src, uint8_t under) {
+            return palette_index(PixelKernels::blend(src, palette[under], weight));
+        };
+        uint16_t last_src = image.row(visible.y - y)[visible.x - x];
+        uint8_t last_dst = dst.index_row(visible.y)[visible.x];
+        uint8_t last_index = lookup(last_src, last_dst);
+        for (int screen_y = visible.y; screen_y < visible.bottom(); ++screen_y) {
+            const uint16_t *src = image.row(screen_y - y) + (visible.x - x);
+            uint8_t *out = dst.index_row(screen_y) + visible.x;
+            for (int i = 0; i < visible.width; ++i) {
+                if (src[i] != last_src || out[i] != last_dst) {
+                    last_src = src[i];
+                    last_dst = out[i];
+                    last_index = lookup(last_src, last_dst);
+                }
+                out[i] = last_index;
+            }
+        }
+        mark_damage(visible);
+        return;
+    }
+    for (int screen_y = visible.y; screen_y < visible.bottom(); ++screen_y) {
+        PixelKernels::blend_copy(
+            dst.row(screen_y) + visible.x,
+            image.row(screen_y - y) + (visible.x - x),
+            visible.width,
+            weight);
+    }
+    mark_damage(visible);
+}
+
+void DisplayDriver::fade_screen(Color color, uint8_t alpha) {
+    if (record(DrawCommand{.kind = DrawCommand::Kind::Fade,
+                           .alpha = alpha,
+                           .color = color,
+                           .area = Rect{0, 0, screen_width, screen_height}})) {
+        return;
+    }
+
+    const RenderTarget &dst = current_target();
+    const Rect &clip = dst.clip;
+    uint16_t weight = PixelKernels::blend_weight(alpha);
+    if (dst.indices != nullptr) {
+        uint8_t lut[DisplayConstants::Palette::Size];
+        blend_lut(lut, color.to_rgb565(), weight);
+        for (int screen_y = clip.y; screen_y < clip.bottom(); ++screen_y) {
+            uint8_t *out = dst.index_row(screen_y) + clip.x;
+            for (int i = 0; i < clip.width; ++i) {
+                out[i] = lut[out[i]];
+            }
+        }
+    } else if (clip.width == dst.stride) { // Contiguous rows are one long span
+        PixelKernels::blend_fill(dst.row(clip.y), clip.area(), color.to_rgb565(), weight);
+    } else {
+        for (int screen_y = clip.y; screen_y < clip.bottom(); ++screen_y) {
+            PixelKernels::blend_fill(
+                dst.row(screen_y) + clip.x, clip.width, color.to_rgb565(), weight);
+        }
+    }
+    mark_damage(clip);
 }
 
 void DisplayDriver::fill_screen(Color color) {
-    for (int y = 0; y < screen_height; ++y) {
-        for (int x = 0; x < screen_width; ++x) {
-            fb[x + screen_width * y] = color.to_rgb565();
+    uint16_t value = color.to_rgb565();
+    if (record(DrawCommand{.kind = DrawCommand::Kind::Fill,
+                           .color = color,
+                           .area = Rect{0, 0, screen_width, screen_height}})) {
+        return;
+    }
+
+    const RenderTarget &dst = current_target();
+    const Rect &clip = dst.clip;
+    if (dst.indices != nullptr) {
+        PixelKernels::fill_rect(dst.index_row(clip.y) + clip.x, dst.stride, clip.width,
+                                clip.height, palette_index(color));
+    } else {
+        PixelKernels::fill_rect(
+            dst.row(clip.y) + clip.x, dst.stride, clip.width, clip.height, value);
+    }
+
+    // Targets without clear tracking do not know what the rest of the frame buffer holds.
+    ClearRecord *clears = dst.clears;
+    if (clears == nullptr) {
+        if (dst.damage != nullptr) {
+            dst.damage->add(clip);
+        }
+        return;
+    }
+
+    // Outside of what was drawn since the last clear the buffer already holds this color.
+    if (clears->valid && clears->color == color) {
+        for (const Rect &rect : clears->drawn) {
+            dst.damage->add(clip.intersect(rect));
+        }
+    } else {
+        dst.damage->add(clip);
+    }
+    clears->drawn.clear();
+    clears->color = color;
+    clears->valid = true;
+}
+
+Rect DisplayDriver::measure_text(
+    int x, int y, const font_descriptor_t *fdes, std::string_view text
+) {
+    int start_x = x;
+    Rect bounds{};
+    for (char letter : text) {
+        if (letter == '\n') {
+            x = start_x;
+            y += fdes->height + DisplayConstants::Text::VerticalSpacing;
+            continue;
+        }
+        if (letter < fdes->firstchar || letter >= fdes->firstchar + fdes->size) {
+            letter = fdes->defaultchar;
+        }
+        int glyph_index = letter - fdes->firstchar;
+        int char_width = (fdes->width) ? fdes->width[glyph_index] : fdes->maxwidth;
+        bounds = bounds.unite(Rect{x, y, char_width, static_cast<int>(fdes->height)});
+        x += char_width + DisplayConstants::Text::HorizontalSpacing;
+    }
+    return bounds;
+}
+
+bool DisplayDriver::record(
+    const DrawCommand &command, std::string_view text, std::span<const Point> points
+) {
+    if (!recording_frame || in_render_callback) {
+        return false;
+    }
+    if (display_lists[current_list].add(command, text, points)) {
+        return true;
+    }
+
+    // Out of space, draw what was recorded so far and the rest of the frame right away.
+    recording_frame = false;
+    record_overflow = true;
+    replay(display_lists[current_list]);
+    return false;
+}
+
+void DisplayDriver::replay(const DisplayList &list) {
+    for (const DrawCommand &command : list) {
+        Color color = command.color;
+        const Rect &area = command.area;
+        switch (command.kind) {
+        case DrawCommand::Kind::Pixel:
+            draw_pixel(area.x, area.y, color);
+            break;
+        case DrawCommand::Kind::Rectangle:
+            draw_rectangle(area.x, area.y, area.width, area.height, color);
+            break;
+        case DrawCommand::Kind::Letter:
+            draw_letter(
+                area.x, area.y, static_cast<FontType>(command.font), list.text(command)[0], color);
+            break;
+        case DrawCommand::Kind::Text:
+            draw_text(
+                area.x, area.y, static_cast<FontType>(command.font), list.text(command), color);
+            break;
+        case DrawCommand::Kind::Sprite:
+            draw_sprite(area.x, area.y, *command.sprite, color);
+            break;
+        case DrawCommand::Kind::Fill:
+            fill_screen(color);
+            break;
+        case DrawCommand::Kind::Image:
+            draw_image(area.x, area.y, command.image);
+            break;
+        case DrawCommand::Kind::KeyedImage:
+            draw_image(area.x, area.y, command.image, color);
+            break;
+        case DrawCommand::Kind::Surface:
+            draw_surface(area.x, area.y, *command.surface);
+            break;
+        case DrawCommand::Kind::KeyedSurface:
+            draw_surface(area.x, area.y, *command.surface, color);
+            break;
+        case DrawCommand::Kind::BlendRectangle:
+            blend_rectangle(area.x, area.y, area.width, area.height, color, command.alpha);
+            break;
+        case DrawCommand::Kind::BlendImage:
+            blend_image(area.x, area.y, command.image, command.alpha);
+            break;
+        case DrawCommand::Kind::Fade:
+            fade_screen(color, command.alpha);
+            break;
+        case DrawCommand::Kind::Line: {
+            std::span<const Point> ends = list.points(command);
+            draw_line(ends[0].x, ends[0].y, ends[1].x, ends[1].y, color);
+            break;
+        }
+        case DrawCommand::Kind::Circle:
+        case DrawCommand::Kind::FilledCircle: {
+            int radius = (area.width - 1) / 2;
+            draw_circle_shape(area.x + radius, area.y + radius, radius, color,
+                              command.kind == DrawCommand::Kind::FilledCircle);
+            break;
+        }
+        case DrawCommand::Kind::Polygon:
+            fill_polygon(list.points(command), color);
+            break;
+        }
+    }
+}
+
+void DisplayDriver::finish_recorded_frame() {
+    Rect screen{0, 0, screen_width, screen_height};
+
+    const DisplayList &current = display_lists[current_list];
+    bool clears_first = !current.empty() && current.begin()->kind == DrawCommand::Kind::Fill;
+
+    if (record_overflow) {
+        // The frame went straight into the frame buffer, the next one has nothing to compare to.
+        record_overflow = false;
+        previous_list_valid = false;
+    } else if (current.empty()) {
+        // Nothing was drawn, the frame buffer still holds the previous frame (scroll() ends
+        // with such a frame).
+        return;
+    } else if (current.blends() && !clears_first) {
+        // Blending over the old contents can not be repeated per area, draw the frame once.
+        recording_frame = false;
+        replay(current);
+        previous_list_valid = false;
+    } else {
+        DamageList changes;
+        if (previous_list_valid) {
+            current.diff(display_lists[1 - current_list], changes);
+        } else {
+            // The frame buffer is up to date, only the recorded commands can change it.
+            for (const DrawCommand &command : current) {
+                changes.add(command.area.intersect(screen));
+            }
+        }
+
+        // Replay area by area, so each pass only rasterizes the pixels of one changed area.
+        recording_frame = false;
+        for (const Rect &rect : changes) {
+            Rect visible = rect.intersect(screen);
+            if (!visible.empty()) {
+                target = frame_target(visible, nullptr);
+                replay(current);
+            }
+        }
+        target = frame_target(screen, &damage);
+        for (const Rect &rect : changes) {
+            mark_damage(rect);
+        }
+        current_list = 1 - current_list;
+        previous_list_valid = true;
+        // The replays bypassed the clear tracking.
+        screen_clear.forget();
+    }
+
+    display_lists[current_list].clear();
+    recording_frame = true;
+}
+
+void DisplayDriver::send_command(uint16_t command, std::initializer_list<int> data) {
+    backend.command(command);
+    for (int value : data) {
+        backend.data(value);
+    }
+}
+
+void DisplayDriver::set_window(const Rect &rect) {
+    int last_column = rect.right() - 1;
+    int last_page = rect.bottom() - 1;
+
+    send_command(DisplayConstants::Panel::ColumnAddressSet,
+                 {rect.x >> 8, rect.x & 0xFF, last_column >> 8, last_column & 0xFF});
+    send_command(DisplayConstants::Panel::PageAddressSet,
+                 {rect.y >> 8, rect.y & 0xFF, last_page >> 8, last_page & 0xFF});
+    send_command(DisplayConstants::Panel::MemoryWrite);
+}
+
+void DisplayDriver::apply_scroll(const ScrollArea &scroll) {
+    if (scroll == panel_scroll) {
+        return;
+    }
+    // MADCTL mirrors the rows, so the panel counts its lines from the bottom of the screen.
+    int fixed_below = DisplayConstants::Panel::Lines - scroll.bottom;
+    int height = scroll.bottom - scroll.top;
+    if (scroll.top != panel_scroll.top || scroll.bottom != panel_scroll.bottom) {
+        send_command(DisplayConstants::Panel::VerticalScrollDefinition,
+                     {fixed_below >> 8, fixed_below & 0xFF, height >> 8, height & 0xFF,
+                      scroll.top >> 8, scroll.top & 0xFF});
+        shadow_valid = false;
+    } else if (shadow_valid) {
+        // The panel shows its rows moved, so the copy of what it shows moves with them.
+        int shift = (scroll.offset - panel_scroll.offset + height) % height;
+        rotate_rows(shadow, screen_width, scroll.top, scroll.bottom, shift);
+    }
+    int start = fixed_below + (height - scroll.offset) % height;
+    send_command(DisplayConstants::Panel::VerticalScrollStart, {start >> 8, start & 0xFF});
+    panel_scroll = scroll;
+}
+
+int DisplayDriver::write_rect(
+    const uint16_t *buffer, int origin_y, const Rect &rect, BusMode mode
+) {
+    if (scale != 1) {
+        return write_upscaled_rect(buffer, origin_y, rect, mode);
+    }
+    set_window(rect);
+
+    if (mode == BusMode::Single) {
+        for (int y = rect.y; y < rect.bottom(); ++y) {
+            const uint16_t *row = &buffer[(y - origin_y) * screen_width];
+            for (int x = rect.x; x < rect.right(); ++x) {
+                backend.write16(row[x]);
+            }
+        }
+        return rect.area();
+    }
+
+    // The window is streamed row after row, so with an odd width a pair spans two rows.
+    bool has_carry = false;
+    uint16_t carry = 0;
+    for (int y = rect.y; y < rect.bottom(); ++y) {
+        const uint16_t *row = &buffer[(y - origin_y) * screen_width];
+        int x = rect.x;
+        if (has_carry) {
+            backend.write32(carry | (static_cast<uint32_t>(row[x]) << 16));
+            has_carry = false;
+            ++x;
+        }
+        for (; x + 1 < rect.right(); x += 2) {
+            backend.write32(row[x] | (static_cast<uint32_t>(row[x + 1]) << 16));
+        }
+        if (x < rect.right()) {
+            carry = row[x];
+            has_carry = true;
+        }
+    }
+    if (has_carry) {
+        backend.write16(carry);
+    }
+    return (rect.area() + 1) / 2;
+}
+
+int DisplayDriver::write_upscaled_rect(
+    const uint16_t *buffer, int origin_y, const Rect &rect, BusMode mode
+) {
+    Rect window{rect.x * 2, rect.y * 2, rect.width * 2, rect.height * 2};
+    set_window(window);
+
+    // The panel window is twice as wide, so every row goes out twice with each pixel doubled.
+    // A doubled pixel is exactly one paired store, there is never a carry into the next row.
+    for (int y = rect.y; y < rect.bottom(); ++y) {
+        const uint16_t *row = &buffer[(y - origin_y) * screen_width];
+        for (int repeat = 0; repeat < 2; ++repeat) {
+            if (mode == BusMode::Single) {
+                for (int x = rect.x; x < rect.right(); ++x) {
+                    backend.write16(row[x]);
+                    backend.write16(row[x]);
+                }
+            } else {
+                for (int x = rect.x; x < rect.right(); ++x) {
+                    backend.write32(row[x] * 0x10001u);
+                }
+            }
+        }
+    }
+    return mode == BusMode::Single ? window.area() : window.area() / 2;
+}
+
+int DisplayDriver::write_scrolled_rect(
+    const uint16_t *buffer, int origin_y, const Rect &rect, BusMode mode
+) {
+    const ScrollArea &scroll = panel_scroll;
+    if (scroll.offset == 0) {
+        return write_rect(buffer, origin_y, rect, mode);
+    }
+
+    // Each range of rows lands in the panel memory moved by a constant number of rows.
+    struct Rows {
+        int top;
+        int bottom;
+        int shift;
+    };
+    int wrap = scroll.bottom - scroll.offset;
+    const Rows ranges[] = {
+        {0, scroll.top, 0},
+        {scroll.top, wrap, scroll.offset},
+        {wrap, scroll.bottom, scroll.top - wrap},
+        {scroll.bottom, screen_height, 0},
+    };
+    int writes = 0;
+    for (const Rows &rows : ranges) {
+        Rect part = rect.intersect(Rect{rect.x, rows.top, rect.width, rows.bottom - rows.top});
+        if (!part.empty()) {
+            // Only the window moves, the pixels are still read from the same buffer rows.
+            part.y += rows.shift;
+            writes += write_rect(buffer, origin_y + rows.shift, part, mode);
         }
     }
+    return writes;
 }
 
 void DisplayDriver::flush() {
-    parlcd_write_cmd(static_cast<uint8_t *>(lcd), 0x2C); // Write to RAM command
-    for (int y = 0; y < screen_height; ++y) {
-        for (int x = 0; x < screen_width; ++x) {
-            parlcd_write_data(
-                static_cast<uint8_t *>(lcd),
-                fb[y * screen_width + x]); // Copy all of the framebuffer data to the display
+    // The render_* functions take care of the frame themselves.
+    if (in_render_callback) {
+        return;
+    }
+    if (draw_mode == DrawMode::Recorded) {
+        finish_recorded_frame();
+    }
+    if (flush_mode == FlushMode::TileHash) {
+        drop_unchanged_tiles();
+    }
+    bool changed = !damage.empty() || scroll_pending;
+    if (!changed && frame_capture == nullptr) {
+        return;
+    }
+
+    // The front buffer belongs to the worker until it finishes the previous frame.
+    if (changed) {
+        wait_for_flush();
+    }
+    for (const Rect &rect : damage) {
+        for (int y = rect.y; y < rect.bottom(); ++y) {
+            int offset = y * screen_width + rect.x;
+            if (color_mode == ColorMode::Indexed8) {
+                PixelKernels::expand_indices(
+                    &front[offset], &index_fb[offset], rect.width, palette);
+            } else {
+                std::memcpy(&front[offset], &fb[offset], rect.width * sizeof(uint16_t));
+            }
         }
     }
+
+    FlushJob job;
+    job.rects = damage;
+    job.buffer = front;
+    job.bus_mode = bus_mode;
+    job.flush_mode = flush_mode;
+    job.reset_shadow = shadow_reset_requested;
+    job.scroll = hardware_scroll() ? scroll_area : ScrollArea{};
+    // The front buffer holds the whole frame, unchanged parts included.
+    job.capture = frame_capture;
+    job.capture_bottom = screen_height;
+    job.changed = changed;
+    submit_flush_job(job);
+    damage.clear();
+    shadow_reset_requested = false;
+    scroll_pending = false;
 }
 
-void DisplayDriver::set_orientation(DisplayOrientation orientation) {
-    this->orientation = orientation;
-    fill_screen(Color::Black); // Clear the screen when changing orientation
+void DisplayDriver::capture_rows(const FlushJob &job) {
+    FrameCapture &capture = *job.capture;
+    if (job.capture_top == 0) {
+        capture_open =
+            capture.begin_frame(screen_width * scale, screen_height * scale, job.changed);
+    }
+    if (!capture_open) {
+        return;
+    }
+    for (int y = job.capture_top; y < job.capture_bottom; ++y) {
+        capture_row(capture, y, &job.buffer[(y - job.origin_y) * screen_width]);
+    }
+    if (job.capture_bottom == screen_height) {
+        capture.end_frame();
+        capture_open = false;
+    }
+}
+
+void DisplayDriver::capture_row(FrameCapture &capture, int y, const uint16_t *row) {
+    if (scale == 1) {
+        capture.write_row(y, row, screen_width);
+        return;
+    }
+    uint16_t doubled[DisplayConstants::Hardware::ScreenWidth];
+    for (int x = 0; x < screen_width; ++x) {
+        doubled[2 * x] = row[x];
+        doubled[2 * x + 1] = row[x];
+    }
+    capture.write_row(2 * y, doubled, 2 * screen_width);
+    capture.write_row(2 * y + 1, doubled, 2 * screen_width);
+}
+
+void DisplayDriver::render_banded(const std::function<void()> &draw) {
+    constexpr int band_height = DisplayConstants::Band::Height;
+
+    // Draw calls recorded so far belong to the frame buffer, the callback bypasses the recording.
+    if (draw_mode == DrawMode::Recorded) {
+        finish_recorded_frame();
+        previous_list_valid = false;
+    }
+
+    in_render_callback = true;
+    for (int top = 0, band = 0; top < screen_height; top += band_height, ++band) {
+        Rect band_rect{0, top, screen_width, std::min(band_height, screen_height - top)};
+
+        // Once band n - 1 is taken the worker is done with band n - 2, so its buffer is free.
+        {
+            std::unique_lock lock(flush_mutex);
+            flush_done_condvar.wait(lock, [this]() { return !flush_requested; });
+        }
+        target = RenderTarget{band_buffers[band % 2], screen_width, top, band_rect, nullptr};
+        draw();
+
+        FlushJob job;
+        job.rects.add(band_rect);
+        job.buffer = band_buffers[band % 2];
+        job.origin_y = top;
+        job.bus_mode = bus_mode;
+        // Bands never pass through the front buffer, so there is nothing to diff against.
+        job.flush_mode = FlushMode::Damage;
+        job.reset_shadow = true;
+        job.scroll = hardware_scroll() ? scroll_area : ScrollArea{};
+        job.capture = frame_capture;
+        job.capture_top = top;
+        job.capture_bottom = band_rect.bottom();
+        submit_flush_job(job);
+    }
+    in_render_callback = false;
+    scroll_pending = false;
+
+    // The band buffers stay in use until the last band is sent.
+    wait_for_flush();
+    target = frame_target(Rect{0, 0, screen_width, screen_height}, &damage);
+
+    // The frame buffer did not see this frame, the next regular flush has to send all of it.
+    tile_hashes_valid = false;
+    damage.clear();
+    damage.add(Rect{0, 0, screen_width, screen_height});
+    screen_clear.forget();
+}
+
+void DisplayDriver::set_scroll_area(int top_fixed, int bottom_fixed) {
+    int top = std::clamp(top_fixed, 0, screen_height);
+    int bottom = std::clamp(screen_height - bottom_fixed, top, screen_height);
+    if (top == scroll_area.top && bottom == scroll_area.bottom) {
+        return;
+    }
+
+    // Scrolled rows sit elsewhere in the panel memory, which the new area does not know about.
+    if (scroll_area.offset != 0) {
+        damage.add(Rect{0, 0, screen_width, screen_height});
+        shadow_reset_requested = true;
+        tile_hashes_valid = false;
+    }
+    scroll_area = ScrollArea{top, bottom, 0};
+    scroll_pending = true;
+}
+
+void DisplayDriver::scroll(int lines, const std::function<void()> &draw) {
+    // Moving the frame buffer rows would land in a band buffer.
+    if (in_render_callback) {
+        draw();
+        return;
+    }
+    // The panel has to hold everything drawn so far before its rows move.
     flush();
+
+    int top = scroll_area.top;
+    int bottom = scroll_area.bottom;
+    int height = bottom - top;
+    if (lines == 0 || height <= 0) {
+        return;
+    }
+
+    Rect screen{0, 0, screen_width, screen_height};
+    Rect exposed{0, top, screen_width, height};
+    if (!hardware_scroll()) {
+        // The panel can not scroll along these rows, move the pixels in the frame buffer.
+        exposed = scroll_region(Rect{0, top, screen_width, height}, -lines);
+    } else {
+        // Rotate the frame buffer the same way the panel is about to rotate its rows.
+        int shift = (lines % height + height) % height;
+        if (color_mode == ColorMode::Indexed8) {
+            rotate_rows(index_fb, screen_width, top, bottom, shift);
+        } else {
+            rotate_rows(fb, screen_width, top, bottom, shift);
+        }
+        // The front buffer keeps matching the panel, the frame capture and TileDiff read it.
+        wait_for_flush();
+        rotate_rows(front, screen_width, top, bottom, shift);
+        scroll_area.offset = (scroll_area.offset + shift) % height;
+        scroll_pending = true;
+        if (lines > 0 && lines < height) {
+            exposed = Rect{0, bottom - lines, screen_width, lines};
+        } else if (lines < 0 && -lines < height) {
+            exposed = Rect{0, top, screen_width, -lines};
+        }
+
+        // The rotated buffer is exactly what the panel shows, exposed rows included.
+        if (tile_hashes_valid) {
+            constexpr int tile_size = DisplayConstants::Flush::TileSize;
+            for (int tile_y = 0; tile_y < screen_height / tile_size; ++tile_y) {
+                for (int tile_x = 0; tile_x < screen_width / tile_size; ++tile_x) {
+                    tile_hashes[tile_y * (screen_width / tile_size) + tile_x] =
+                        tile_hash(tile_x, tile_y);
+                }
+            }
+        }
+    }
+
+    DamageList exposed_damage;
+    RenderTarget exposed_target = frame_target(exposed, &exposed_damage);
+    if (draw_mode == DrawMode::Recorded) {
+        // Record the frame once, so the next frame is compared against it as usual.
+        draw();
+        if (record_overflow) {
+            // The frame went straight into the frame buffer.
+            record_overflow = false;
+            previous_list_valid = false;
+        } else {
+            recording_frame = false;
+            target = exposed_target;
+            replay(display_lists[current_list]);
+            target = frame_target(screen, &damage);
+            current_list = 1 - current_list;
+            previous_list_valid = true;
+        }
+        display_lists[current_list].clear();
+        recording_frame = true;
+    } else {
+        in_render_callback = true;
+        target = exposed_target;
+        draw();
+        target = frame_target(screen, &damage);
+        in_render_callback = false;
+    }
+
+    damage.add(exposed_damage);
+    screen_clear.forget();
 }
 
-int DisplayDriver::get_width() const {
-    if (orientation == DisplayOrientation::Landscape) {
-        return screen_width;
+Rect DisplayDriver::scroll_region(const Rect &rect, int dy) {
+    if (in_render_callback) {
+        return Rect{};
+    }
+    // Recorded commands have to be in the frame buffer before its pixels move.
+    if (draw_mode == DrawMode::Recorded) {
+        finish_recorded_frame();
+        previous_list_valid = false;
+    }
+
+    Rect area = rect.intersect(Rect{0, 0, screen_width, screen_height});
+    if (area.empty() || dy == 0) {
+        return Rect{};
+    }
+    Rect exposed = area;
+    if (std::abs(dy) < area.height) {
+        int count = area.height - std::abs(dy);
+        int from = dy > 0 ? area.y : area.y - dy;
+        if (color_mode == ColorMode::Indexed8) {
+            move_rows(index_fb, screen_width, area.x, area.width, from, from + dy, count);
+        } else {
+            move_rows(fb, screen_width, area.x, area.width, from, from + dy, count);
+        }
+        exposed = dy > 0 ? Rect{area.x, area.y, area.width, dy}
+                         : Rect{area.x, area.bottom() + dy, area.width, -dy};
+    }
+    // The panel still shows the old rows, so the whole area has to be sent again.
+    mark_damage(area);
+    return exposed;
+}
+
+void DisplayDriver::set_frame_capture(FrameCapture *capture) {
+    // The worker may still be storing a frame in the old capture.
+    wait_for_flush();
+    frame_capture = capture;
+}
+
+uint32_t DisplayDriver::tile_hash(int tile_x, int tile_y) const {
+    constexpr int tile_size = DisplayConstants::Flush::TileSize;
+    int offset = (tile_y * screen_width + tile_x) * tile_size;
+    if (color_mode == ColorMode::Indexed8) {
+        return PixelKernels::hash_rect(&index_fb[offset], screen_width, tile_size, tile_size);
+    }
+    return PixelKernels::hash_rect(&fb[offset], screen_width, tile_size, tile_size);
+}
+
+void DisplayDriver::drop_unchanged_tiles() {
+    constexpr int tile_size = DisplayConstants::Flush::TileSize;
+    int tiles_per_row = screen_width / tile_size;
+
+    // Without valid hashes nothing is known about the panel, send everything once.
+    if (!tile_hashes_valid) {
+        damage.clear();
+        damage.add(Rect{0, 0, screen_width, screen_height});
+    }
+
+    // A tile covered by two damaged rectangles is hashed twice, the second time it matches.
+    DamageList changed;
+    for (const Rect &rect : damage) {
+        int first_tile_x = rect.x / tile_size;
+        int last_tile_x = (rect.right() - 1) / tile_size;
+        for (int tile_y = rect.y / tile_size; tile_y <= (rect.bottom() - 1) / tile_size;
+             ++tile_y) {
+            int run_start = -1;
+
+            for (int tile_x = first_tile_x; tile_x <= last_tile_x; ++tile_x) {
+                uint32_t hash = tile_hash(tile_x, tile_y);
+                uint32_t &stored = tile_hashes[tile_y * tiles_per_row + tile_x];
+                bool tile_changed = !tile_hashes_valid || hash != stored;
+                stored = hash;
+
+                if (tile_changed && run_start < 0) {
+                    run_start = tile_x;
+                } else if (!tile_changed && run_start >= 0) {
+                    changed.add(Rect{run_start * tile_size, tile_y * tile_size,
+                                     (tile_x - run_start) * tile_size, tile_size});
+                    run_start = -1;
+                }
+            }
+            if (run_start >= 0) {
+                changed.add(Rect{run_start * tile_size, tile_y * tile_size,
+                                 (last_tile_x + 1 - run_start) * tile_size, tile_size});
+            }
+        }
+    }
+
+    damage = changed;
+    tile_hashes_valid = true;
+}
+
+void DisplayDriver::submit_flush_job(const FlushJob &job) {
+    {
+        std::unique_lock lock(flush_mutex);
+        flush_done_condvar.wait(lock, [this]() { return !flush_requested; });
+        flush_job = job;
+        flush_requested = true;
+    }
+    flush_condvar.notify_one();
+}
+
+void DisplayDriver::wait_for_flush() {
+    std::unique_lock lock(flush_mutex);
+    flush_done_condvar.wait(lock, [this]() { return !flush_requested && !flush_running; });
+}
+
+void DisplayDriver::write_changed_tiles(const Rect &rect, BusMode mode, FlushStats &stats) {
+    constexpr int tile_size = DisplayConstants::Flush::TileSize;
+
+    auto send_run = [&](const Rect &run) {
+        stats.pixels += run.area() * scale * scale;
+        stats.bus_writes += write_scrolled_rect(front, 0, run, mode);
+        for (int y = run.y; y < run.bottom(); ++y) {
+            int offset = y * screen_width + run.x;
+            std::memcpy(&shadow[offset], &front[offset], run.width * sizeof(uint16_t));
+        }
+    };
+
+    // Walk the tile grid row by row and send runs of neighbouring changed tiles as one window.
+    int first_tile_y = rect.y - rect.y % tile_size;
+    int first_tile_x = rect.x - rect.x % tile_size;
+    for (int tile_y = first_tile_y; tile_y < rect.bottom(); tile_y += tile_size) {
+        int top = std::max(tile_y, rect.y);
+        int bottom = std::min(tile_y + tile_size, rect.bottom());
+        int run_start = -1;
+
+        for (int tile_x = first_tile_x; tile_x < rect.right(); tile_x += tile_size) {
+            int left = std::max(tile_x, rect.x);
+            int right = std::min(tile_x + tile_size, rect.right());
+            bool changed = false;
+            for (int y = top; y < bottom && !changed; ++y) {
+                int offset = y * screen_width + left;
+                changed = std::memcmp(
+                    &front[offset], &shadow[offset], (right - left) * sizeof(uint16_t));
+            }
+
+            if (changed && run_start < 0) {
+                run_start = left;
+            } else if (!changed && run_start >= 0) {
+                send_run(Rect{run_start, top, left - run_start, bottom - top});
+                run_start = -1;
+            }
+        }
+        if (run_start >= 0) {
+            send_run(Rect{run_start, top, rect.right() - run_start, bottom - top});
+        }
+    }
+}
+
+void DisplayDriver::flush_thread_loop(std::stop_token stop_token) {
+    while (!stop_token.stop_requested()) {
+        FlushJob job;
+        {
+            std::unique_lock lock(flush_mutex);
+            flush_condvar.wait(lock, [this, &stop_token]() {
+                return flush_requested || stop_token.stop_requested();
+            });
+
+            if (stop_token.stop_requested()) {
+                break;
+            }
+
+            job = flush_job;
+            if (job.reset_shadow) {
+                shadow_valid = false;
+            }
+            flush_requested = false;
+            flush_running = true;
+        }
+        // The job slot is free again, render_banded() may already submit the next band.
+        flush_done_condvar.notify_all();
+
+        auto start_time = std::chrono::steady_clock::now();
+        apply_scroll(job.scroll);
+        FlushStats stats;
+        if (job.flush_mode == FlushMode::TileDiff && shadow_valid) {
+            for (const Rect &rect : job.rects) {
+                write_changed_tiles(rect, job.bus_mode, stats);
+            }
+        } else {
+            for (const Rect &rect : job.rects) {
+                stats.pixels += rect.area() * scale * scale;
+                stats.bus_writes +=
+                    write_scrolled_rect(job.buffer, job.origin_y, rect, job.bus_mode);
+            }
+            // The panel now shows the front buffer, so it can become the shadow.
+            if (job.flush_mode == FlushMode::TileDiff) {
+                std::memcpy(shadow, front, sizeof(PixelBuffers::shadow));
+            }
+            shadow_valid = job.flush_mode == FlushMode::TileDiff;
+        }
+        stats.duration = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start_time);
+
+        // After the bus, so the capture does not delay the frame on the panel.
+        if (job.capture != nullptr) {
+            capture_rows(job);
+        }
+
+        {
+            std::lock_guard lock(flush_mutex);
+            flush_stats = stats;
+            flush_running = false;
+        }
+        flush_done_condvar.notify_all();
+    }
+}
+
+void DisplayDriver::set_bus_mode(BusMode mode) {
+    bus_mode = mode;
+}
+
+void DisplayDriver::set_flush_mode(FlushMode mode) {
+    flush_mode = mode;
+    tile_hashes_valid = false;
+}
+
+void DisplayDriver::set_color_mode(ColorMode mode) {
+    if (mode == color_mode) {
+        return;
+    }
+    // Finish the recorded frame in the old format.
+    if (draw_mode == DrawMode::Recorded) {
+        finish_recorded_frame();
+    }
+
+    if (mode == ColorMode::Rgb565) {
+        PixelKernels::expand_indices(fb, index_fb, screen_width * screen_height, palette);
     } else {
-        return screen_height;
+        std::memset(index_fb, 0, sizeof(PixelBuffers::indices));
     }
+    color_mode = mode;
+    target = frame_target(Rect{0, 0, screen_width, screen_height}, &damage);
+
+    // Nothing that was tracked about the old buffer applies to the new one.
+    damage.clear();
+    damage.add(Rect{0, 0, screen_width, screen_height});
+    screen_clear.forget();
+    tile_hashes_valid = false;
+    previous_list_valid = false;
 }
 
-int DisplayDriver::get_height() const {
+void DisplayDriver::set_palette(std::span<const Color> colors) {
+    int count = std::min(static_cast<int>(colors.size()), DisplayConstants::Palette::Size);
+    palette_slots.reset();
+    for (int i = 0; i < count; ++i) {
+        palette[i] = colors[i].to_rgb565();
+        palette_slots[i] = colors[i].get_slot() == i;
+    }
+    palette_size = std::max(count, 1);
+    palette_has_plain = static_cast<int>(palette_slots.count()) < palette_size;
+    if (color_mode != ColorMode::Indexed8) {
+        return;
+    }
+
+    // Every pixel may look different now, and recorded colors may map to other indices.
+    damage.clear();
+    damage.add(Rect{0, 0, screen_width, screen_height});
+    screen_clear.forget();
+    tile_hashes_valid = false;
+    previous_list_valid = false;
+}
+
+uint8_t DisplayDriver::palette_index(uint16_t color) const {
+    int best = 0;
+    int best_distance = INT_MAX;
+    for (int i = 0; i < palette_size; ++i) {
+        if (palette_has_plain && palette_slots[i]) {
+            continue;
+        }
+        if (palette[i] == color) {
+            return static_cast<uint8_t>(i);
+        }
+        // Squared distance of the 5/6/5 bit channels, good enough for picking a fallback.
+        int red = (palette[i] >> 11) - (color >> 11);
+        int green = ((palette[i] >> 5) & 0x3F) - ((color >> 5) & 0x3F);
+        int blue = (palette[i] & 0x1F) - (color & 0x1F);
+        int distance = 4 * red * red + green * green + 4 * blue * blue;
+        if (distance < best_distance) {
+            best = i;
+            best_distance = distance;
+        }
+    }
+    return static_cast<uint8_t>(best);
+}
+
+uint8_t DisplayDriver::palette_index(Color color) const {
+    uint8_t slot = color.get_slot();
+    if (slot < palette_size && palette_slots[slot]) {
+        return slot;
+    }
+    return palette_index(color.to_rgb565());
+}
+
+void DisplayDriver::quantize_rect(uint8_t *dst, int dst_stride, const uint16_t *src,
+                                  int src_stride, int width, int height, bool keyed,
+                                  uint16_t key) const {
+    // Images repeat colors along a row, a lookup is only needed when the color changes.
+    uint16_t last_color = src[0];
+    uint8_t last_index = palette_index(last_color);
+    for (int row = 0; row < height; ++row, dst += dst_stride, src += src_stride) {
+        for (int i = 0; i < width; ++i) {
+            if (keyed && src[i] == key) {
+                continue;
+            }
+            if (src[i] != last_color) {
+                last_color = src[i];
+                last_index = palette_index(last_color);
+            }
+            dst[i] = last_index;
+        }
+    }
+}
+
+void DisplayDriver::blend_lut(uint8_t *lut, uint16_t color, uint16_t weight) const {
+    for (int i = 0; i < DisplayConstants::Palette::Size; ++i) {
+        lut[i] = i < palette_size
+                     ? palette_index(PixelKernels::blend(color, palette[i], weight))
+                     : static_cast<uint8_t>(i);
+    }
+}
+
+void DisplayDriver::set_draw_mode(DrawMode mode) {
+    // Draw whatever is still recorded, the frame buffer has to be complete in both modes.
+    if (draw_mode == DrawMode::Recorded) {
+        finish_recorded_frame();
+    }
+    draw_mode = mode;
+    recording_frame = mode == DrawMode::Recorded;
+    previous_list_valid = false;
+}
+
+FlushStats DisplayDriver::get_flush_stats() const {
+    std::lock_guard lock(flush_mutex);
+    return flush_stats;
+}
+
+void DisplayDriver::apply_orientation() {
+    scale = resolution == Resolution::Half ? 2 : 1;
     if (orientation == DisplayOrientation::Landscape) {
-        return screen_height;
+        screen_width = DisplayConstants::Hardware::ScreenWidth / scale;
+        screen_height = DisplayConstants::Hardware::ScreenHeight / scale;
     } else {
-        return screen_width;
+        screen_width = DisplayConstants::Hardware::ScreenHeight / scale;
+        screen_height = DisplayConstants::Hardware::ScreenWidth / scale;
+    }
+    target = frame_target(Rect{0, 0, screen_width, screen_height}, &damage);
+
+    send_command(
+        DisplayConstants::Panel::MemoryAccessControl,
+        {orientation == DisplayOrientation::Landscape ? DisplayConstants::Panel::MadctlLandscape
+                                                      : DisplayConstants::Panel::MadctlPortrait});
+
+    // The scroll of the previous orientation would move the rows of the new one. The worker is
+    // idle here and the shadow is reset anyway, it has the old layout.
+    shadow_valid = false;
+    apply_scroll(ScrollArea{});
+    scroll_area = ScrollArea{0, screen_height, 0};
+    scroll_pending = false;
+}
+
+void DisplayDriver::set_orientation(DisplayOrientation orientation) {
+    // The panel registers belong to the worker while it is sending a frame.
+    wait_for_flush();
+    this->orientation = orientation;
+    apply_orientation();
+
+    // The buffer layout changed, none of the tracked contents are valid anymore.
+    screen_clear.forget();
+    damage.clear();
+    shadow_reset_requested = true;
+    tile_hashes_valid = false;
+    display_lists[current_list].clear();
+    previous_list_valid = false;
+    record_overflow = false;
+    recording_frame = draw_mode == DrawMode::Recorded;
+    fill_screen(Color::Black); // Clear the screen when changing orientation
+    flush();
+}
+
+void DisplayDriver::set_resolution(Resolution resolution) {
+    if (resolution == this->resolution) {
+        return;
     }
-}
\ No newline at end of file
+    this->resolution = resolution;
+    // The new size is applied together with the orientation.
+    set_orientation(orientation);
+}
+
+int DisplayDriver::get_width() const {
+    return screen_width;
+}
+
+int DisplayDriver::get_height() const {
+    return screen_height;
+}
@@ -29,6 +29,8 @@
 
 int main() {
     DisplayDriver screen(DisplayOrientation::Portrait);
+    screen.set_flush_mode(FlushMode::TileHash); // Modules redraw mostly identical frames
+    screen.set_draw_mode(DrawMode::Recorded);   // Only rasterize what changed between frames
     screen.fill_screen(Color::Black);
     void *spiled_mem_base = map_phys_address(SPILED_REG_BASE_PHYS, SPILED_REG_SIZE, 0);
     if (!spiled_mem_base) {
@@ -37,6 +39,9 @@ int main() {
     SpiledDriver spiled = SpiledDriver(spiled_mem_base);
     AudioDriver buzzer = AudioDriver();
     Theme main_theme = DefaultTheme;
+    // Themes only use a handful of colors, draw palette indices and expand them on flush
+    screen.set_palette(theme_palette(main_theme));
+    screen.set_color_mode(ColorMode::Indexed8);
     StateFlag current_flag = StateFlag::Menu;
     spiled.init_knobs();
 
@@ -75,6 +75,7 @@ void SettingsModule::update() {
     }
     if (spiled->read_knob_press(KnobColor::Green)) {
         *main_theme = ThemeList[setting_selected];
+        screen->set_palette(theme_palette(*main_theme));
         return;
     }
     int selected_copy = setting_selected;
@@ -34,6 +34,7 @@ TutorialModule::~TutorialModule() {
 
 void TutorialModule::switch_setup() {
     screen->set_orientation(DisplayOrientation::Portrait);
+    scrolled_lines = 0; // The screen was cleared, the next redraw draws everything
 }
 
 void TutorialModule::switch_to(StateFlag new_mod) {
@@ -54,6 +55,7 @@ void TutorialModule::update() {
     }
     int pos_change = spiled->read_knob_change(KnobColor::Green);
     if (pos_change != 0) {
+        int old_position = text_position;
         if (text_position + pos_change < Constants::Text::vertical_limit_neg) {
             text_position = Constants::Text::vertical_limit_neg;
         } else if (text_position + pos_change > Constants::Text::vertical_limit_pos) {
@@ -61,6 +63,7 @@ void TutorialModule::update() {
         } else {
             text_position += pos_change;
         }
+        scrolled_lines += text_position - old_position;
     }
 }
 
@@ -80,13 +83,22 @@ Fun fact, you can scroll on this page\nusing the Green knob, try it!\n\n\
 \n\n\n\n\n\n\n\n\
 Good job! :)\
 ";
-    screen->fill_screen(main_theme->background);
-    screen->draw_text(
-        0, 
-        text_position, 
-        main_theme->font, 
-        text, 
-        main_theme->text
-    );
+    auto draw = [this, text]() {
+        screen->fill_screen(main_theme->background);
+        screen->draw_text(
+            0, 
+            text_position, 
+            main_theme->font, 
+            text, 
+            main_theme->text
+        );
+    };
+    // The display scrolls the text it already shows, only the uncovered lines are drawn.
+    if (scrolled_lines != 0) {
+        screen->scroll(-scrolled_lines, draw);
+        scrolled_lines = 0;
+    } else {
+        draw();
+    }
     screen->flush();
 }
\ No newline at end of file
@@ -0,0 +1,205 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 Matyas Godula
+
+/// @file bench_flush.cpp
+/// @brief Measures DisplayDriver::flush() with one and two pixels per store, small damage
+/// windows and the tile diffing modes skipping unchanged tiles, then the game redraw in the modes
+/// of main() with recorded and with immediate drawing.
+/// @author Matyas Godula
+/// @date 17.10.2026
+/// @note On the board (make bench-flush) the times are real and the run ends with the cost of a
+/// store and of a pixel solved from the two full frame cases. A host build charges the costs
+/// given on the command line to every bus access of the emulated panel, so its times predict the
+/// board: ./bench_flush [store_ns pixel_ns]
+
+#include "include/drivers/AudioDriver.hpp"
+#include "include/drivers/DisplayDriver.hpp"
+#include "include/drivers/SpiledDriver.hpp"
+#include "include/utils/Color.hpp"
+#include "include/utils/Theme.hpp"
+
+#include "app_space_invaders/include/modules/GameModule.hpp"
+
+#include "third_party/mzapo/mzapo_regs.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <iterator>
+
+namespace {
+    constexpr int Frames = 30;
+    constexpr int Sprites = 8;
+    constexpr int SpriteSize = 16;
+    constexpr uint32_t GameSeed = 2025;
+
+#if defined(DISPLAY_BACKEND_MEMORY)
+    // Rough guesses, replace them with what make bench-flush prints on the board.
+    constexpr double DefaultStoreNs = 60;
+    constexpr double DefaultPixelNs = 10;
+#endif
+
+    struct Result {
+        double flush_us = 0; ///< Time the worker spent on the bus per frame.
+        double frame_us = 0; ///< Time of drawing, flush() and wait_for_flush() per frame.
+        double pixels = 0;
+        double bus_writes = 0;
+    };
+
+    struct Case {
+        const char *name;
+        BusMode bus;
+        FlushMode flush;
+        std::function<void(int)> draw; ///< Draws the given frame.
+        DrawMode draw_mode = DrawMode::Immediate;
+        ColorMode color = ColorMode::Rgb565;
+    };
+
+    /// @brief Draws the first frame, then averages the frames after it.
+    Result measure(DisplayDriver &screen, const Case &test) {
+        screen.set_bus_mode(test.bus);
+        screen.set_flush_mode(test.flush);
+        screen.set_draw_mode(test.draw_mode);
+        screen.set_color_mode(test.color);
+        test.draw(0);
+        screen.flush();
+        screen.wait_for_flush();
+
+        Result result;
+        auto start = std::chrono::steady_clock::now();
+        for (int frame = 1; frame <= Frames; ++frame) {
+            test.draw(frame);
+            screen.flush();
+            screen.wait_for_flush();
+            FlushStats stats = screen.get_flush_stats();
+            result.flush_us += stats.duration.count();
+            result.pixels += stats.pixels;
+            result.bus_writes += stats.bus_writes;
+        }
+        std::chrono::duration<double, std::micro> elapsed =
+            std::chrono::steady_clock::now() - start;
+        result.frame_us = elapsed.count() / Frames;
+        result.flush_us /= Frames;
+        result.pixels /= Frames;
+        result.bus_writes /= Frames;
+        return result;
+    }
+
+    void print(const Case &test, const Result &result) {
+        std::printf("%-20s %10.0f %10.0f %12.1f %12.1f\n", test.name, result.pixels,
+                    result.bus_writes, result.flush_us, result.frame_us);
+    }
+} // namespace
+
+int main(int argc, char **argv) {
+    DisplayDriver screen(DisplayOrientation::Landscape);
+    int width = screen.get_width();
+    int height = screen.get_height();
+
+#if defined(DISPLAY_BACKEND_MEMORY)
+    MemoryBackend::BusCost cost{DefaultStoreNs, DefaultPixelNs};
+    if (argc == 3) {
+        cost.store_ns = std::atof(argv[1]);
+        cost.pixel_ns = std::atof(argv[2]);
+    }
+    screen.get_backend().set_bus_cost(cost);
+    std::printf("Emulated panel, %.1f ns per store and %.1f ns per pixel\n\n", cost.store_ns,
+                cost.pixel_ns);
+#else
+    (void)argc;
+    (void)argv;
+#endif
+
+    // Sprites moving over a static background, the frame is redrawn from scratch or only where
+    // the sprites were.
+    auto sprite_x = [width](int sprite, int frame) {
+        return (sprite * 53 + frame * 3) % (width - SpriteSize);
+    };
+    auto sprite_y = [height](int sprite) { return 20 + sprite * (height - 40) / Sprites; };
+    auto full_frame = [&](int frame) {
+        screen.fill_screen(frame % 2 ? Color::Blue : Color::Black);
+    };
+    auto sprites = [&](int frame) {
+        if (frame == 0) {
+            screen.fill_screen(Color::Black);
+        }
+        for (int sprite = 0; sprite < Sprites; ++sprite) {
+            if (frame > 0) {
+                screen.draw_rectangle(sprite_x(sprite, frame - 1), sprite_y(sprite), SpriteSize,
+                                      SpriteSize, Color::Black);
+            }
+            screen.draw_rectangle(sprite_x(sprite, frame), sprite_y(sprite), SpriteSize,
+                                  SpriteSize, Color::Yellow);
+        }
+    };
+    auto redraw = [&](int frame) {
+        screen.draw_rectangle(0, 0, width, height, Color::Black);
+        for (int sprite = 0; sprite < Sprites; ++sprite) {
+            screen.draw_rectangle(sprite_x(sprite, frame), sprite_y(sprite), SpriteSize,
+                                  SpriteSize, Color::Yellow);
+        }
+    };
+
+    const Case cases[] = {
+        {"full frame, single", BusMode::Single, FlushMode::Damage, full_frame},
+        {"full frame, paired", BusMode::Paired, FlushMode::Damage, full_frame},
+        {"sprites, damage", BusMode::Paired, FlushMode::Damage, sprites},
+        {"redraw, damage", BusMode::Paired, FlushMode::Damage, redraw},
+        {"redraw, tile diff", BusMode::Paired, FlushMode::TileDiff, redraw},
+        {"redraw, tile hash", BusMode::Paired, FlushMode::TileHash, redraw},
+    };
+
+    Result results[std::size(cases)];
+    std::printf("%-20s %10s %10s %12s %12s\n", "case", "pixels", "stores", "flush [us]",
+                "frame [us]");
+    for (size_t i = 0; i < std::size(cases); ++i) {
+        results[i] = measure(screen, cases[i]);
+        print(cases[i], results[i]);
+    }
+
+    // Both full frame cases send the same pixels, the difference is only in the stores.
+    const Result &single = results[0];
+    const Result &paired = results[1];
+    double store_ns = 1000 * (single.flush_us - paired.flush_us) /
+                      (single.bus_writes - paired.bus_writes);
+    double pixel_ns = (1000 * single.flush_us - single.bus_writes * store_ns) / single.pixels;
+    std::printf("\nFitted bus cost: %.1f ns per store, %.1f ns per pixel\n", store_ns, pixel_ns);
+
+    // The game in the modes of main(), the knobs and the buzzer are plain memory. Every case
+    // starts from the same seed, so both draw the same frames.
+    DisplayDriver game_screen(DisplayOrientation::Portrait, BufferStorage::Heap);
+    game_screen.set_palette(theme_palette(DefaultTheme));
+#if defined(DISPLAY_BACKEND_MEMORY)
+    game_screen.get_backend().set_bus_cost(cost);
+#endif
+    uint32_t knob_registers[SPILED_REG_SIZE / 4] = {};
+    uint32_t pwm_registers[AUDIOPWM_REG_SIZE / 4] = {};
+    SpiledDriver spiled(knob_registers);
+    AudioDriver buzzer(pwm_registers);
+    Theme theme = DefaultTheme;
+    StateFlag flag = StateFlag::Game;
+    GameModule game(&game_screen, &buzzer, &spiled, &theme, &flag);
+    auto play = [&](int frame) {
+        if (frame == 0) {
+            flag = StateFlag::Game;
+            game.reset_game();
+            game.seed(GameSeed);
+            game.switch_setup();
+        }
+        game.update();
+        game.redraw();
+    };
+
+    const Case game_cases[] = {
+        {"game, recorded", BusMode::Single, FlushMode::TileHash, play, DrawMode::Recorded,
+         ColorMode::Indexed8},
+        {"game, immediate", BusMode::Single, FlushMode::TileHash, play, DrawMode::Immediate,
+         ColorMode::Indexed8},
+    };
+    std::printf("\n");
+    for (const Case &test : game_cases) {
+        print(test, measure(game_screen, test));
+    }
+    return 0;
+}
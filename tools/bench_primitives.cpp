@@ -0,0 +1,236 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 Matyas Godula
+
+/// @file bench_primitives.cpp
+/// @brief Compares the span based line, circle and polygon primitives with drawing the same
+/// shapes pixel by pixel through draw_pixel().
+/// @author Matyas Godula
+/// @date 17.10.2026
+/// @note Runs on the MZ-APO board (make bench), only the rasterization into the frame buffer is
+/// timed. The result is flushed once at the end so the shapes can be checked on the display.
+
+#include "include/drivers/DisplayDriver.hpp"
+#include "include/utils/Color.hpp"
+#include "include/utils/Point.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <span>
+
+namespace {
+    constexpr int Runs = 20;
+
+    /// @brief Returns the average time of one call of draw in microseconds.
+    double time_us(const std::function<void()> &draw) {
+        draw(); // Warm up the caches
+        auto start = std::chrono::steady_clock::now();
+        for (int run = 0; run < Runs; ++run) {
+            draw();
+        }
+        std::chrono::duration<double, std::micro> elapsed =
+            std::chrono::steady_clock::now() - start;
+        return elapsed.count() / Runs;
+    }
+
+    /// @brief Textbook Bresenham, every pixel goes through draw_pixel().
+    void naive_line(DisplayDriver &screen, int x0, int y0, int x1, int y1, Color color) {
+        int dx = std::abs(x1 - x0);
+        int dy = -std::abs(y1 - y0);
+        int sx = x0 < x1 ? 1 : -1;
+        int sy = y0 < y1 ? 1 : -1;
+        int error = dx + dy;
+        while (true) {
+            screen.draw_pixel(x0, y0, color);
+            if (x0 == x1 && y0 == y1) {
+                break;
+            }
+            int doubled = 2 * error;
+            if (doubled >= dy) {
+                error += dy;
+                x0 += sx;
+            }
+            if (doubled <= dx) {
+                error += dx;
+                y0 += sy;
+            }
+        }
+    }
+
+    /// @brief Midpoint circle plotting all eight octants through draw_pixel().
+    void naive_circle(DisplayDriver &screen, int cx, int cy, int radius, Color color) {
+        int x = 0;
+        int y = radius;
+        int error = 1 - radius;
+        while (x <= y) {
+            screen.draw_pixel(cx + x, cy + y, color);
+            screen.draw_pixel(cx - x, cy + y, color);
+            screen.draw_pixel(cx + x, cy - y, color);
+            screen.draw_pixel(cx - x, cy - y, color);
+            screen.draw_pixel(cx + y, cy + x, color);
+            screen.draw_pixel(cx - y, cy + x, color);
+            screen.draw_pixel(cx + y, cy - x, color);
+            screen.draw_pixel(cx - y, cy - x, color);
+            if (error < 0) {
+                error += 2 * x + 3;
+            } else {
+                error += 2 * (x - y) + 5;
+                --y;
+            }
+            ++x;
+        }
+    }
+
+    /// @brief Tests every pixel of the bounding box against the circle.
+    void naive_fill_circle(DisplayDriver &screen, int cx, int cy, int radius, Color color) {
+        for (int y = -radius; y <= radius; ++y) {
+            for (int x = -radius; x <= radius; ++x) {
+                if (x * x + y * y <= radius * radius + radius) {
+                    screen.draw_pixel(cx + x, cy + y, color);
+                }
+            }
+        }
+    }
+
+    /// @brief Tests every pixel of the bounding box against every edge (even-odd rule).
+    void naive_polygon(DisplayDriver &screen, std::span<const Point> points, Color color) {
+        int min_x = points[0].x, max_x = points[0].x;
+        int min_y = points[0].y, max_y = points[0].y;
+        for (const Point &point : points) {
+            min_x = std::min(min_x, point.x);
+            max_x = std::max(max_x, point.x);
+            min_y = std::min(min_y, point.y);
+            max_y = std::max(max_y, point.y);
+        }
+        for (int y = min_y; y < max_y; ++y) {
+            for (int x = min_x; x < max_x; ++x) {
+                bool inside = false;
+                for (size_t i = 0; i < points.size(); ++i) {
+                    Point a = points[i];
+                    Point b = points[(i + 1) % points.size()];
+                    if ((a.y <= y) == (b.y <= y)) {
+                        continue;
+                    }
+                    // Is the pixel right of the edge, compared without dividing.
+                    int cross = (x - a.x) * (b.y - a.y) - (y - a.y) * (b.x - a.x);
+                    if ((b.y > a.y) ? cross >= 0 : cross <= 0) {
+                        inside = !inside;
+                    }
+                }
+                if (inside) {
+                    screen.draw_pixel(x, y, color);
+                }
+            }
+        }
+    }
+
+    struct Case {
+        const char *name;
+        std::function<void()> naive;
+        std::function<void()> spans;
+    };
+} // namespace
+
+int main() {
+    DisplayDriver screen(DisplayOrientation::Landscape);
+    int width = screen.get_width();
+    int height = screen.get_height();
+
+    const Point star[] = {
+        {240, 20}, {270, 120}, {380, 120}, {290, 180}, {330, 290},
+        {240, 220}, {150, 290}, {190, 180}, {100, 120}, {210, 120},
+    };
+    const Point hexagon[] = {
+        {140, 40}, {340, 40}, {440, 160}, {340, 280}, {140, 280}, {40, 160},
+    };
+
+    Case cases[] = {
+        {"horizontal lines",
+         [&] {
+             for (int y = 0; y < height; ++y) {
+                 naive_line(screen, 0, y, width - 1, y, Color::Red);
+             }
+         },
+         [&] {
+             for (int y = 0; y < height; ++y) {
+                 screen.draw_line(0, y, width - 1, y, Color::Red);
+             }
+         }},
+        {"vertical lines",
+         [&] {
+             for (int x = 0; x < width; ++x) {
+                 naive_line(screen, x, 0, x, height - 1, Color::Green);
+             }
+         },
+         [&] {
+             for (int x = 0; x < width; ++x) {
+                 screen.draw_line(x, 0, x, height - 1, Color::Green);
+             }
+         }},
+        {"diagonal lines",
+         [&] {
+             for (int x = 0; x < width; x += 4) {
+                 naive_line(screen, x, 0, width - 1 - x, height - 1, Color::Cyan);
+             }
+         },
+         [&] {
+             for (int x = 0; x < width; x += 4) {
+                 screen.draw_line(x, 0, width - 1 - x, height - 1, Color::Cyan);
+             }
+         }},
+        {"mostly clipped lines",
+         [&] {
+             for (int y = -64; y < 64; ++y) {
+                 naive_line(screen, -2000, y * 8, 2500, 300 - y, Color::Yellow);
+             }
+         },
+         [&] {
+             for (int y = -64; y < 64; ++y) {
+                 screen.draw_line(-2000, y * 8, 2500, 300 - y, Color::Yellow);
+             }
+         }},
+        {"circles",
+         [&] {
+             for (int radius = 4; radius < 160; radius += 4) {
+                 naive_circle(screen, width / 2, height / 2, radius, Color::White);
+             }
+         },
+         [&] {
+             for (int radius = 4; radius < 160; radius += 4) {
+                 screen.draw_circle(width / 2, height / 2, radius, Color::White);
+             }
+         }},
+        {"filled circles",
+         [&] {
+             for (int i = 0; i < 8; ++i) {
+                 naive_fill_circle(screen, 60 + i * 50, height / 2, 60, Color::Magenta);
+             }
+         },
+         [&] {
+             for (int i = 0; i < 8; ++i) {
+                 screen.fill_circle(60 + i * 50, height / 2, 60, Color::Magenta);
+             }
+         }},
+        {"concave polygon",
+         [&] { naive_polygon(screen, star, Color::Blue); },
+         [&] { screen.fill_polygon(star, Color::Blue); }},
+        {"convex polygon",
+         [&] { naive_polygon(screen, hexagon, Color::Red); },
+         [&] { screen.fill_polygon(hexagon, Color::Red); }},
+    };
+
+    std::printf("%-22s %12s %12s %8s\n", "shape", "pixels [us]", "spans [us]", "speedup");
+    for (const Case &test : cases) {
+        screen.fill_screen(Color::Black);
+        double naive = time_us(test.naive);
+        screen.fill_screen(Color::Black);
+        double spans = time_us(test.spans);
+        std::printf("%-22s %12.1f %12.1f %7.1fx\n", test.name, naive, spans, naive / spans);
+    }
+
+    screen.flush();
+    screen.wait_for_flush();
+    return 0;
+}
@@ -0,0 +1,789 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 Matyas Godula
+
+/// @file golden_frames.cpp
+/// @brief Runs the modules with scripted knob input under several driver setups and compares the
+/// hash of every frame with the golden hashes in tools/golden_frames.txt.
+/// @author Matyas Godula
+/// @date 17.10.2026
+/// @note Needs the memory backend (make golden CC=gcc CXX=g++), the hashes are taken from what
+/// the emulated panel shows, so a change anywhere between a draw call and the bus shows up.
+/// Run with --update after an intended change of the output and commit the new hashes, they are
+/// taken from the plain reference setup.
+/// @note Every setup has to produce the same hashes, so the flush, draw and color modes and the
+/// render_* functions can not change what the panel shows.
+/// @note The checks after the scenarios need no golden data, each one draws the same picture in
+/// two ways and compares the panels: scrolling against drawing from scratch, half resolution
+/// against the picture scaled up by hand, surfaces against drawing straight to the screen,
+/// sprites and images changing in place against the reference setup and theme switches without a
+/// redraw against redrawing in the new theme. The capture checks read frame captures back and
+/// compare them with the panel.
+
+#include "include/drivers/AudioDriver.hpp"
+#include "include/drivers/DisplayDriver.hpp"
+#include "include/drivers/SpiledDriver.hpp"
+#include "include/modules/Module.hpp"
+#include "include/sprites/Surface.hpp"
+#include "include/utils/Color.hpp"
+#include "include/utils/FrameCapture.hpp"
+#include "include/utils/Theme.hpp"
+
+#include "app_space_invaders/assets/sprites/ShieldSprite.hpp"
+#include "app_space_invaders/include/modules/GameModule.hpp"
+#include "internal/modules/GameEndModule.hpp"
+#include "internal/modules/MenuModule.hpp"
+#include "internal/modules/SettingsModule.hpp"
+#include "internal/modules/TutorialModule.hpp"
+
+#include "third_party/mzapo/mzapo_regs.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <span>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+    constexpr const char *DefaultPath = "tools/golden_frames.txt";
+    constexpr uint32_t Seed = 2025; // Seed of the alien shots
+    constexpr int ScrollHeader = 24;  // Fixed rows above the scrolled page
+    constexpr int ScrollFooter = 10;  // Fixed rows below it
+    constexpr int ScrollSteps[] = {1, 7, 30, -12, 100, -45, 3, 250, -300, 16};
+    constexpr int HalfFrames = 6;
+    constexpr int SurfaceFrames = 6;
+    constexpr int ChangeFrames = 6;
+    // Enough changed frames in both formats to grow the capture past its first 16 MiB chunk.
+    constexpr int CaptureFlushes = 72;
+    constexpr int CaptureRepeat = 6; // Every sixth flush draws the previous picture again
+    constexpr long CaptureChunk = 16 << 20;
+
+    /// @brief Knob input held for a number of frames.
+    struct Step {
+        int frames;          ///< How many frames the input is held.
+        int green = 0;       ///< Green knob turn per frame.
+        uint8_t buttons = 0; ///< Pressed knobs, the bits of the SPILED register.
+    };
+
+    constexpr uint8_t Blue = 0x01;
+    constexpr uint8_t Green = 0x02;
+    constexpr uint8_t Red = 0x04;
+
+    struct Scenario {
+        const char *name;
+        StateFlag start;
+        std::span<const Step> steps;
+        /// @brief The module sleeps in redraw(), which render_banded() calls once per band.
+        bool paced = false;
+    };
+
+    constexpr Step MenuSteps[] = {
+        {3}, {6, 2}, {4}, {10, -1}, {2}, {6, 4}, {3, -4},
+    };
+    constexpr Step SettingsSteps[] = {
+        {2}, {8, 2}, {1, 0, Green}, {3}, {12, 1}, {1, 0, Green}, {2}, {6, -3}, {1, 0, Green}, {2},
+        {1, 0, Red}, {3},
+    };
+    constexpr Step TutorialSteps[] = {
+        {2}, {10, -12}, {3}, {6, 15}, {4, -40}, {2}, {1, 0, Blue}, {8, 3},
+    };
+    constexpr Step GameSteps[] = {
+        {5}, {20, -6}, {1, 0, Blue}, {15}, {10, 9}, {1, 0, Blue}, {20, 3}, {1, 0, Blue}, {30},
+        {12, -5}, {1, 0, Blue}, {40}, {1, 0, Red}, {3},
+    };
+    constexpr Step GameEndSteps[] = {
+        {2}, {4, 2}, {3}, {4, -2}, {2}, {1, 0, Green}, {4},
+    };
+
+    constexpr Scenario Scenarios[] = {
+        {"menu", StateFlag::Menu, MenuSteps},
+        {"settings", StateFlag::Settings, SettingsSteps, true},
+        {"tutorial", StateFlag::Tutorial, TutorialSteps},
+        {"game", StateFlag::Game, GameSteps},
+        {"win", StateFlag::Win, GameEndSteps},
+        {"loss", StateFlag::Loss, GameEndSteps},
+    };
+
+    struct ScrollCheck {
+        const char *name;
+        DisplayOrientation orientation;
+        Resolution resolution;
+    };
+
+    // Hardware scroll in portrait, scroll_region() in landscape and at half resolution.
+    constexpr ScrollCheck ScrollChecks[] = {
+        {"portrait", DisplayOrientation::Portrait, Resolution::Full},
+        {"landscape", DisplayOrientation::Landscape, Resolution::Full},
+        {"half", DisplayOrientation::Portrait, Resolution::Half},
+    };
+
+    /// @brief How the frames of a scenario are drawn.
+    enum class Render : uint8_t {
+        Direct,   ///< The modules draw into the frame buffer, like in main().
+        Banded,   ///< Every redraw runs inside of render_banded().
+    };
+
+    /// @brief Driver modes a scenario runs with.
+    struct Setup {
+        const char *name;
+        FlushMode flush;
+        DrawMode draw;
+        ColorMode color;
+        BusMode bus = BusMode::Single;
+        Render render = Render::Direct;
+    };
+
+    // The first setup is the reference --update takes the hashes from, the second one is main().
+    constexpr Setup Setups[] = {
+        {"reference", FlushMode::Damage, DrawMode::Immediate, ColorMode::Rgb565},
+        {"main", FlushMode::TileHash, DrawMode::Recorded, ColorMode::Indexed8},
+        {"tilediff", FlushMode::TileDiff, DrawMode::Immediate, ColorMode::Rgb565, BusMode::Paired},
+        {"recorded", FlushMode::Damage, DrawMode::Recorded, ColorMode::Rgb565},
+        {"banded", FlushMode::Damage, DrawMode::Immediate, ColorMode::Rgb565, BusMode::Single,
+         Render::Banded},
+    };
+
+    /// @brief Plain memory standing in for the SPILED registers.
+    class KnobRegisters {
+        public:
+            void *base() { return words; }
+
+            /// @brief Turns the green knob and sets the pressed buttons for the next frame.
+            void set(int green_turn, uint8_t buttons) {
+                green = static_cast<uint8_t>(green + green_turn);
+                words[SPILED_REG_KNOBS_8BIT_o / 4] =
+                    static_cast<uint32_t>(buttons) << 24 | static_cast<uint32_t>(green) << 8;
+            }
+
+        private:
+            uint32_t words[SPILED_REG_SIZE / 4] = {};
+            uint8_t green = 0;
+    };
+
+    /// @brief FNV-1a of the size and every pixel of a frame.
+    /// @param pixel Returns the RGB565 pixel at (x, y).
+    template <typename Pixel> uint32_t pixels_hash(int width, int height, Pixel pixel) {
+        uint32_t hash = 2166136261u;
+        auto mix = [&hash](uint32_t value) {
+            hash = (hash ^ (value & 0xFF)) * 16777619u;
+            hash = (hash ^ (value >> 8)) * 16777619u;
+        };
+        mix(width);
+        mix(height);
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                mix(pixel(x, y));
+            }
+        }
+        return hash;
+    }
+
+    /// @brief FNV-1a of the size and every pixel the panel shows.
+    uint32_t frame_hash(const DisplayDriver &screen) {
+        const PanelBackend &panel = screen.get_backend();
+        return pixels_hash(panel.width(), panel.height(),
+                           [&panel](int x, int y) { return panel.pixel(x, y); });
+    }
+
+    /// @brief Puts a driver into the modes of a setup, with the palette of main().
+    void apply(DisplayDriver &screen, const Setup &setup) {
+        screen.set_flush_mode(setup.flush);
+        screen.set_draw_mode(setup.draw);
+        screen.set_bus_mode(setup.bus);
+        screen.set_palette(theme_palette(DefaultTheme));
+        screen.set_color_mode(setup.color);
+    }
+
+    /// @brief Draws a frame the way the setup renders and waits until the panel shows it.
+    void render(DisplayDriver &screen, const Setup &setup, const std::function<void()> &draw) {
+        if (setup.render == Render::Banded) {
+            // The bands are sent as they are drawn, the frame buffer holds nothing to flush.
+            screen.render_banded(draw);
+        } else {
+            draw();
+            screen.flush();
+        }
+        screen.wait_for_flush();
+    }
+
+    /// @brief Whether two panels show the same pixels.
+    bool same_panel(const DisplayDriver &screen, const DisplayDriver &expected) {
+        const PanelBackend &panel = screen.get_backend();
+        const PanelBackend &reference = expected.get_backend();
+        if (panel.width() != reference.width() || panel.height() != reference.height()) {
+            return false;
+        }
+        for (int y = 0; y < panel.height(); ++y) {
+            for (int x = 0; x < panel.width(); ++x) {
+                if (panel.pixel(x, y) != reference.pixel(x, y)) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    /// @brief Runs a scenario the way main() runs the game and hashes every frame.
+    std::vector<uint32_t> run(const Scenario &scenario, const Setup &setup) {
+        DisplayDriver screen(DisplayOrientation::Portrait, BufferStorage::Heap);
+        apply(screen, setup);
+        screen.fill_screen(Color::Black);
+        KnobRegisters knobs;
+        SpiledDriver spiled(knobs.base());
+        uint32_t pwm_registers[AUDIOPWM_REG_SIZE / 4] = {};
+        AudioDriver buzzer(pwm_registers);
+        Theme main_theme = DefaultTheme;
+        StateFlag current_flag = scenario.start;
+        spiled.init_knobs();
+
+        SettingsModule settings(&screen, &buzzer, &spiled, &main_theme, &current_flag);
+        MenuModule menu(&screen, &buzzer, &spiled, &main_theme, &current_flag);
+        GameModule game(&screen, &buzzer, &spiled, &main_theme, &current_flag);
+        TutorialModule tutorial(&screen, &buzzer, &spiled, &main_theme, &current_flag);
+        GameEndModule game_end(&screen, &buzzer, &spiled, &main_theme, &current_flag);
+        game.seed(Seed);
+
+        // Same transitions as the main loop.
+        auto select = [&]() -> Module * {
+            switch (current_flag) {
+            case StateFlag::Settings:
+                return &settings;
+            case StateFlag::Tutorial:
+                return &tutorial;
+            case StateFlag::Game:
+                return &game;
+            case StateFlag::Win:
+                game_end.set_game_end_state(GameEndState::Win);
+                return &game_end;
+            case StateFlag::Loss:
+                game_end.set_game_end_state(GameEndState::Loss);
+                return &game_end;
+            case StateFlag::ResetGame:
+                game.reset_game();
+                game_end.set_game_end_state(GameEndState::Ongoing);
+                current_flag = StateFlag::Menu;
+                return &menu;
+            default:
+                return &menu;
+            }
+        };
+        Module *current_module = select();
+        current_module->switch_setup();
+
+        std::vector<uint32_t> hashes;
+        for (const Step &step : scenario.steps) {
+            for (int frame = 0; frame < step.frames; ++frame) {
+                knobs.set(step.green, step.buttons);
+                StateFlag previous_flag = current_flag;
+                current_module->update();
+                if (current_flag == StateFlag::Exit) {
+                    return hashes;
+                }
+                if (previous_flag != current_flag) {
+                    current_module = select();
+                    current_module->switch_setup();
+                }
+                render(screen, setup, [current_module]() { current_module->redraw(); });
+                hashes.push_back(frame_hash(screen));
+            }
+        }
+        return hashes;
+    }
+
+    /// @brief A page taller than the screen between a fixed header and footer.
+    /// @param position How far the page is scrolled.
+    void draw_page(DisplayDriver &screen, int position) {
+        constexpr int StripeHeight = 16;
+        constexpr Color Colors[] = {Color::Red, Color::Green, Color::Blue, Color::Yellow,
+                                    Color::White};
+        int width = screen.get_width();
+        int height = screen.get_height();
+        screen.fill_screen(Color::Black);
+        // Stripes of different offsets and widths, so a row moved to the wrong place shows up.
+        for (int stripe = position / StripeHeight; stripe * StripeHeight - position < height;
+             ++stripe) {
+            screen.draw_rectangle(stripe * 37 % (width / 2), stripe * StripeHeight - position,
+                                  width / 4 + stripe * 11 % (width / 3), StripeHeight - 2,
+                                  Colors[stripe % std::size(Colors)]);
+        }
+        screen.draw_rectangle(0, 0, width, ScrollHeader, Color::Blue);
+        screen.draw_rectangle(0, height - ScrollFooter, width, ScrollFooter, Color::Red);
+    }
+
+    /// @brief Scrolls a page back and forth and compares the panel with a full redraw after
+    /// every step.
+    /// @return The step that showed a difference, -1 if all of them matched.
+    int check_scroll(DisplayOrientation orientation, Resolution resolution) {
+        DisplayDriver scrolled(orientation, BufferStorage::Heap);
+        DisplayDriver reference(orientation, BufferStorage::Heap);
+        scrolled.set_resolution(resolution);
+        reference.set_resolution(resolution);
+        scrolled.set_scroll_area(ScrollHeader, ScrollFooter);
+
+        int position = 0;
+        draw_page(scrolled, position);
+        scrolled.flush();
+        for (size_t step = 0; step < std::size(ScrollSteps); ++step) {
+            position += ScrollSteps[step];
+            scrolled.scroll(ScrollSteps[step], [&]() { draw_page(scrolled, position); });
+            scrolled.flush();
+            scrolled.wait_for_flush();
+            draw_page(reference, position);
+            reference.flush();
+            reference.wait_for_flush();
+            if (!same_panel(scrolled, reference)) {
+                return static_cast<int>(step);
+            }
+        }
+        return -1;
+    }
+
+    /// @brief Rectangles, an image and a blend whose coordinates all scale with unit.
+    /// @param image The same image at unit times its size.
+    void draw_scaled(DisplayDriver &screen, int unit, const Image &image, int frame) {
+        constexpr Color Colors[] = {Color::Red, Color::Green, Color::Yellow, Color::White};
+        screen.fill_screen(Color::Blue);
+        for (int i = 0; i < 12; ++i) {
+            screen.draw_rectangle(unit * ((i * 29 + frame * 7) % 120), unit * (8 + i * 12),
+                                  unit * 15, unit * 6, Colors[i % std::size(Colors)]);
+        }
+        screen.draw_image(unit * (20 + frame * 3), unit * 40, image);
+        screen.blend_rectangle(unit * 5, unit * 5, unit * 100, unit * 30, Color::White, 96);
+    }
+
+    /// @brief Draws moving frames at half resolution and at full resolution with every
+    /// coordinate doubled, the panels have to match.
+    /// @return The frame that showed a difference, -1 if all of them matched.
+    int check_half(DisplayOrientation orientation, const Setup &setup) {
+        constexpr int Size = 16;
+        uint16_t small[Size * Size];
+        uint16_t doubled[4 * Size * Size];
+        for (int y = 0; y < 2 * Size; ++y) {
+            for (int x = 0; x < 2 * Size; ++x) {
+                uint16_t pixel = static_cast<uint16_t>((x / 2) * 0x0841 ^ (y / 2) * 0x1003);
+                small[(y / 2) * Size + x / 2] = pixel;
+                doubled[y * 2 * Size + x] = pixel;
+            }
+        }
+
+        DisplayDriver half(orientation, BufferStorage::Heap);
+        DisplayDriver full(orientation, BufferStorage::Heap);
+        apply(half, setup);
+        apply(full, setup);
+        half.set_resolution(Resolution::Half);
+        for (int frame = 0; frame < HalfFrames; ++frame) {
+            render(half, setup, [&]() { draw_scaled(half, 1, Image(Size, Size, small), frame); });
+            render(full, setup, [&]() {
+                draw_scaled(full, 2, Image(2 * Size, 2 * Size, doubled), frame);
+            });
+            if (!same_panel(half, full)) {
+                return frame;
+            }
+        }
+        return -1;
+    }
+
+    /// @brief A box with a label, drawn at the origin.
+    void draw_label(DisplayDriver &screen, int frame) {
+        screen.draw_rectangle(0, 0, 90, 40, Color::Green);
+        screen.draw_text(4, 4, FontType::ROM8x16, "Surface", Color::White);
+        screen.draw_text(4, 20, FontType::WinFreeSystem14x16, frame % 2 ? "odd" : "even",
+                         Color::Black);
+    }
+
+    /// @brief Copies labels drawn into surfaces onto moving positions and draws the same labels
+    /// straight onto a second screen, the panels have to match.
+    /// @return The frame that showed a difference, -1 if all of them matched.
+    int check_surfaces(const Setup &setup) {
+        DisplayDriver copied(DisplayOrientation::Portrait, BufferStorage::Heap);
+        DisplayDriver direct(DisplayOrientation::Portrait, BufferStorage::Heap);
+        apply(copied, setup);
+        apply(direct, setup);
+
+        // A surface in the format of the frame buffer and one in the other format, the copy of
+        // the second one leaves out the black text.
+        Surface same(90, 40, setup.color);
+        Surface other(90, 40,
+                      setup.color == ColorMode::Rgb565 ? ColorMode::Indexed8 : ColorMode::Rgb565);
+        for (int frame = 0; frame < SurfaceFrames; ++frame) {
+            copied.draw_to(same, [&]() { draw_label(copied, frame); });
+            copied.draw_to(other, [&]() { draw_label(copied, frame); });
+            int x = 10 + frame * 13;
+            int y = 30 + frame * 21;
+            render(copied, setup, [&]() {
+                copied.fill_screen(Color::Blue);
+                copied.draw_surface(x, y, same);
+                copied.draw_surface(y, x + 150, other, Color::Black);
+            });
+            render(direct, setup, [&]() {
+                direct.fill_screen(Color::Blue);
+                direct.draw_rectangle(x, y, 90, 40, Color::Green);
+                direct.draw_text(x + 4, y + 4, FontType::ROM8x16, "Surface", Color::White);
+                direct.draw_text(x + 4, y + 20, FontType::WinFreeSystem14x16,
+                                 frame % 2 ? "odd" : "even", Color::Black);
+                direct.draw_rectangle(y, x + 150, 90, 40, Color::Green);
+                direct.draw_text(y + 4, x + 154, FontType::ROM8x16, "Surface", Color::White);
+                // The keyed copy shows the background through the black text.
+                direct.draw_text(y + 4, x + 170, FontType::WinFreeSystem14x16,
+                                 frame % 2 ? "odd" : "even", Color::Blue);
+            });
+            if (!same_panel(copied, direct)) {
+                return frame;
+            }
+        }
+        return -1;
+    }
+
+    /// @brief Draws a shield and an image at the same place every frame while their pixels
+    /// change in place, like a shield getting shot, and compares the panel with the reference
+    /// setup drawing the same.
+    /// @return The frame that showed a difference, -1 if all of them matched.
+    int check_changes(const Setup &setup) {
+        constexpr int Size = 24;
+        constexpr Color Colors[] = {Color::Red, Color::Yellow, Color::Cyan, Color::White};
+        DisplayDriver changed(DisplayOrientation::Portrait, BufferStorage::Heap);
+        DisplayDriver reference(DisplayOrientation::Portrait, BufferStorage::Heap);
+        apply(changed, setup);
+        apply(reference, Setups[0]);
+
+        ShieldSprite shield;
+        uint16_t pixels[Size * Size] = {};
+        uint32_t version = 0;
+        for (int frame = 0; frame < ChangeFrames; ++frame) {
+            if (frame > 0) {
+                shield.damage_area(10 * frame, 5 + 6 * frame, 6);
+                // Palette colors only, so the indexed setups draw the same.
+                for (int i = frame; i < Size * Size; i += 7) {
+                    pixels[i] = Colors[(i + frame) % std::size(Colors)].to_rgb565();
+                }
+                ++version;
+            }
+            for (DisplayDriver *screen : {&changed, &reference}) {
+                render(*screen, screen == &changed ? setup : Setups[0], [&]() {
+                    screen->fill_screen(Color::Black);
+                    screen->draw_sprite(40, 60, shield, Color::Green);
+                    screen->draw_image(150, 60, Image(Size, Size, pixels, 0, version));
+                });
+            }
+            if (!same_panel(changed, reference)) {
+                return frame;
+            }
+        }
+        return -1;
+    }
+
+    /// @brief Every theme role and a few named colors, the text in a fixed font.
+    void draw_themed(DisplayDriver &screen, const Theme &theme) {
+        screen.fill_screen(theme.background);
+        screen.draw_text(10, 10, FontType::ROM8x16, "Score: 100", theme.text);
+        screen.draw_rectangle(20, 60, 60, 30, theme.turret);
+        screen.draw_rectangle(100, 60, 60, 30, theme.shield);
+        screen.draw_rectangle(180, 60, 60, 30, theme.aliens);
+        screen.draw_rectangle(20, 110, 220, 20, theme.selection);
+        // Named colors keep their color in every theme, even where a role shares it.
+        screen.draw_rectangle(20, 150, 60, 30, Color::White);
+        screen.draw_rectangle(100, 150, 60, 30, Color::Green);
+        screen.draw_rectangle(180, 150, 60, 30, Color::Black);
+    }
+
+    /// @brief Draws the default theme once and switches the palette through every theme without
+    /// drawing again, each switch has to show what drawing in the new theme shows.
+    /// @return The theme that showed a difference, -1 if all of them matched.
+    int check_themes(const Setup &setup) {
+        // Only the indexed mode recolors drawn pixels.
+        if (setup.color != ColorMode::Indexed8) {
+            return -1;
+        }
+        DisplayDriver switched(DisplayOrientation::Portrait, BufferStorage::Heap);
+        apply(switched, setup);
+        render(switched, setup, [&]() { draw_themed(switched, DefaultTheme); });
+        for (int theme = 0; theme < ThemeCount; ++theme) {
+            switched.set_palette(theme_palette(ThemeList[theme]));
+            render(switched, setup, []() {});
+
+            DisplayDriver redrawn(DisplayOrientation::Portrait, BufferStorage::Heap);
+            apply(redrawn, setup);
+            redrawn.set_palette(theme_palette(ThemeList[theme]));
+            render(redrawn, setup, [&]() { draw_themed(redrawn, ThemeList[theme]); });
+            if (!same_panel(switched, redrawn)) {
+                return theme;
+            }
+        }
+        return -1;
+    }
+
+    /// @brief A frame read back from a capture file.
+    struct CapturedFrame {
+        uint32_t number; ///< Flush the frame was taken at.
+        int width;
+        int height;
+        uint32_t hash; ///< pixels_hash() of the RGB565 pixels.
+    };
+
+    /// @brief Parses a capture file, PPM frames are turned back into RGB565.
+    /// @return False if the file ends inside of a frame or a header is wrong.
+    bool read_capture(const std::filesystem::path &path, CaptureFormat format,
+                      std::vector<CapturedFrame> &frames) {
+        std::ifstream file(path, std::ios::binary);
+        std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)),
+                                  std::istreambuf_iterator<char>());
+        size_t size = data.size();
+        data.push_back(0); // Stops sscanf() at the end of the file
+        size_t offset = 0;
+        while (offset < size) {
+            CapturedFrame frame{};
+            if (format == CaptureFormat::Rgb565) {
+                CaptureHeader header;
+                if (size - offset < sizeof(header)) {
+                    return false;
+                }
+                std::memcpy(&header, &data[offset], sizeof(header));
+                if (std::memcmp(header.magic, "F565", 4) != 0 || header.reserved != 0) {
+                    return false;
+                }
+                frame = {header.frame, header.width, header.height, 0};
+                offset += sizeof(header);
+            } else {
+                int consumed = 0;
+                if (std::sscanf(reinterpret_cast<const char *>(&data[offset]),
+                                "P6\n# frame %u\n%d %d\n255%n", &frame.number, &frame.width,
+                                &frame.height, &consumed) != 3 ||
+                    consumed == 0 || data[offset + consumed] != '\n') {
+                    return false;
+                }
+                offset += consumed + 1;
+            }
+            size_t pixel_size = format == CaptureFormat::Rgb565 ? 2 : 3;
+            size_t bytes = static_cast<size_t>(frame.width) * frame.height * pixel_size;
+            if (size - offset < bytes) {
+                return false;
+            }
+            const uint8_t *pixels = &data[offset];
+            int width = frame.width;
+            if (format == CaptureFormat::Rgb565) {
+                frame.hash = pixels_hash(width, frame.height, [pixels, width](int x, int y) {
+                    uint16_t pixel;
+                    std::memcpy(&pixel, pixels + 2 * (y * width + x), sizeof(pixel));
+                    return pixel;
+                });
+            } else {
+                // The PPM expansion repeats the top bits, shifting them out is lossless.
+                frame.hash = pixels_hash(width, frame.height, [pixels, width](int x, int y) {
+                    const uint8_t *rgb = pixels + 3 * (y * width + x);
+                    return static_cast<uint16_t>((rgb[0] >> 3) << 11 | (rgb[1] >> 2) << 5 |
+                                                 rgb[2] >> 3);
+                });
+            }
+            offset += bytes;
+            frames.push_back(frame);
+        }
+        return true;
+    }
+
+    /// @brief Captures moving pages to a file, reads it back and compares every frame and its
+    /// header with what the panel showed after that flush.
+    /// @note A changed_only capture may only leave out a flush that showed the picture of the one
+    /// before, and with recorded drawing it has to leave out every repeated picture.
+    /// @return The first frame read back that did not match, -1 if all of them matched.
+    int check_capture(const Setup &setup, CaptureFormat format, bool changed_only) {
+        std::filesystem::path path = std::filesystem::temp_directory_path() / "golden_capture.bin";
+        DisplayDriver screen(DisplayOrientation::Portrait, BufferStorage::Heap);
+        apply(screen, setup);
+        std::vector<uint32_t> shown;
+        {
+            FrameCapture capture(path.string().c_str(), format, changed_only);
+            screen.set_frame_capture(&capture);
+            int position = 0;
+            for (int flush = 0; flush < CaptureFlushes; ++flush) {
+                if (flush % CaptureRepeat != CaptureRepeat - 1) {
+                    position += 7;
+                }
+                render(screen, setup, [&]() { draw_page(screen, position); });
+                shown.push_back(frame_hash(screen));
+            }
+            screen.set_frame_capture(nullptr);
+        }
+        std::vector<CapturedFrame> frames;
+        bool parsed = read_capture(path, format, frames);
+        // The check is only worth something if the file grew past its first chunk.
+        bool grown = std::filesystem::file_size(path) > CaptureChunk;
+        std::filesystem::remove(path);
+        if (!parsed || !grown) {
+            return static_cast<int>(frames.size());
+        }
+
+        const PanelBackend &panel = screen.get_backend();
+        uint32_t next = 0;
+        for (size_t i = 0; i <= frames.size(); ++i) {
+            uint32_t number = i < frames.size() ? frames[i].number : CaptureFlushes;
+            if (number < next || number > CaptureFlushes) {
+                return static_cast<int>(i);
+            }
+            for (uint32_t skipped = next; skipped < number; ++skipped) {
+                if (!changed_only || skipped == 0 || shown[skipped] != shown[skipped - 1]) {
+                    return static_cast<int>(i);
+                }
+            }
+            if (i == frames.size()) {
+                break;
+            }
+            if (frames[i].width != panel.width() || frames[i].height != panel.height() ||
+                frames[i].hash != shown[number]) {
+                return static_cast<int>(i);
+            }
+            next = number + 1;
+        }
+        // Recorded drawing knows that a repeated picture changed nothing.
+        size_t expected = CaptureFlushes;
+        if (changed_only && setup.draw == DrawMode::Recorded) {
+            expected -= CaptureFlushes / CaptureRepeat;
+        }
+        if (frames.size() != expected) {
+            return static_cast<int>(frames.size());
+        }
+        return -1;
+    }
+
+    /// @brief Reads "scenario frame hash" lines, # starts a comment.
+    std::map<std::string, std::vector<uint32_t>> load(const char *path) {
+        std::map<std::string, std::vector<uint32_t>> golden;
+        std::ifstream file(path);
+        std::string line;
+        while (std::getline(file, line)) {
+            if (line.empty() || line[0] == '#') {
+                continue;
+            }
+            std::istringstream fields(line);
+            std::string name;
+            size_t frame = 0;
+            uint32_t hash = 0;
+            if (fields >> name >> frame >> std::hex >> hash) {
+                std::vector<uint32_t> &hashes = golden[name];
+                hashes.resize(std::max(hashes.size(), frame + 1));
+                hashes[frame] = hash;
+            }
+        }
+        return golden;
+    }
+} // namespace
+
+int main(int argc, char **argv) {
+    bool update = false;
+    const char *path = DefaultPath;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--update") == 0) {
+            update = true;
+        } else {
+            path = argv[i];
+        }
+    }
+
+    std::map<std::string, std::vector<uint32_t>> golden = load(path);
+    int failures = 0;
+    for (const Scenario &scenario : Scenarios) {
+        // With --update the reference setup decides the hashes the other setups have to match.
+        std::vector<uint32_t> &expected = golden[scenario.name];
+        if (update) {
+            expected = run(scenario, Setups[0]);
+        }
+
+        bool passed = true;
+        size_t setups = 0;
+        for (const Setup &setup : std::span(Setups).subspan(update ? 1 : 0)) {
+            // A paced module would sleep through every band, minutes per scenario.
+            if (scenario.paced && setup.render == Render::Banded) {
+                continue;
+            }
+            ++setups;
+            std::vector<uint32_t> hashes = run(scenario, setup);
+            size_t frame = 0;
+            while (frame < hashes.size() && frame < expected.size() &&
+                   hashes[frame] == expected[frame]) {
+                ++frame;
+            }
+            if (frame != hashes.size() || frame != expected.size()) {
+                // Later frames depend on the first different one, only that one is worth
+                // reporting.
+                std::printf("%-10s %4zu frames  FAILED with %s at frame %zu\n", scenario.name,
+                            hashes.size(), setup.name, frame);
+                passed = false;
+                ++failures;
+            }
+        }
+        if (passed) {
+            std::printf("%-10s %4zu frames  ok in %zu setups\n", scenario.name, expected.size(),
+                        setups + (update ? 1 : 0));
+        }
+    }
+
+    // Each check draws the same picture in two ways under every setup.
+    const std::pair<const char *, std::function<int(const Setup &)>> checks[] = {
+        {"half portrait", [](const Setup &setup) {
+             return check_half(DisplayOrientation::Portrait, setup);
+         }},
+        {"half landscape", [](const Setup &setup) {
+             return check_half(DisplayOrientation::Landscape, setup);
+         }},
+        {"surfaces", check_surfaces},
+        {"changes", check_changes},
+        {"themes", check_themes},
+        {"capture ppm", [](const Setup &setup) {
+             return check_capture(setup, CaptureFormat::Ppm, false);
+         }},
+        {"capture rgb565", [](const Setup &setup) {
+             return check_capture(setup, CaptureFormat::Rgb565, false);
+         }},
+        {"capture changed", [](const Setup &setup) {
+             return check_capture(setup, CaptureFormat::Rgb565, true);
+         }},
+    };
+    for (const auto &[name, check] : checks) {
+        bool passed = true;
+        for (const Setup &setup : Setups) {
+            int frame = check(setup);
+            if (frame >= 0) {
+                std::printf("%-16s FAILED with %s at frame %d\n", name, setup.name, frame);
+                passed = false;
+                ++failures;
+            }
+        }
+        if (passed) {
+            std::printf("%-16s ok in %zu setups\n", name, std::size(Setups));
+        }
+    }
+
+    for (const ScrollCheck &check : ScrollChecks) {
+        int step = check_scroll(check.orientation, check.resolution);
+        if (step < 0) {
+            std::printf("scroll %-9s %2zu steps  ok\n", check.name, std::size(ScrollSteps));
+        } else {
+            std::printf("scroll %-9s FAILED at step %d\n", check.name, step);
+            ++failures;
+        }
+    }
+
+    if (update) {
+        std::ofstream file(path);
+        file << "# Golden frame hashes: scenario, frame, FNV-1a of the panel contents\n"
+             << "# Regenerate with ./golden_frames --update after an intended change\n";
+        for (const Scenario &scenario : Scenarios) {
+            const std::vector<uint32_t> &hashes = golden[scenario.name];
+            for (size_t frame = 0; frame < hashes.size(); ++frame) {
+                char line[64];
+                std::snprintf(line, sizeof(line), "%s %zu %08x\n", scenario.name, frame,
+                              hashes[frame]);
+                file << line;
+            }
+        }
+        std::printf("Updated %s\n", path);
+    }
+    return failures == 0 ? 0 : 1;
+}